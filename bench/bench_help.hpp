@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace bench {
+
+// A message of exactly N bytes. The sequence number gives the consumer
+// something to read so the optimizer can't discard the payload.
+template<std::size_t N>
+struct payload {
+    static_assert(N > sizeof(std::uint64_t));
+    std::uint64_t seq = 0;
+    unsigned char pad[N - sizeof(std::uint64_t)] = {};
+};
+
+template<typename T>
+T make(std::uint64_t seq) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return static_cast<T>(seq);
+    }
+    else {
+        auto v = T{};
+        v.seq = seq;
+        return v;
+    }
+}
+
+template<typename T>
+std::uint64_t sequence(const T& v) {
+    if constexpr (std::is_arithmetic_v<T>) return static_cast<std::uint64_t>(v);
+    else return v.seq;
+}
+
+template<typename T>
+std::string payload_name() {
+    if constexpr (std::is_same_v<T, int>) return "int";
+    else if constexpr (sizeof(T) < 1024) return std::to_string(sizeof(T)) + "B";
+    else return std::to_string(sizeof(T) / 1024) + "KiB";
+}
+
+struct measurement {
+    double wall_seconds;
+    double cpu_seconds;
+};
+
+// Measures both wall time and process-wide CPU time. std::clock is CPU time on
+// POSIX systems, but wall time on Windows, so CPU figures are only meaningful
+// on the former.
+struct stopwatch {
+    void start() noexcept {
+        _wall = std::chrono::steady_clock::now();
+        _cpu = std::clock();
+    }
+
+    measurement stop() const noexcept {
+        const auto cpu = std::clock();
+        const auto wall = std::chrono::steady_clock::now();
+        return {
+            std::chrono::duration<double>(wall - _wall).count(),
+            static_cast<double>(cpu - _cpu) / CLOCKS_PER_SEC
+        };
+    }
+
+private:
+    std::chrono::steady_clock::time_point _wall = {};
+    std::clock_t _cpu = {};
+};
+
+struct options {
+    std::size_t messages = 1 << 18;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    double rate = 100000; // offered load, for benchmarks that use one
+};
+
+// Recognizes `-n <messages>`, `-t <max threads>` and `-r <messages/sec>`.
+inline options parse_options(int argc, char** argv) {
+    auto opts = options{};
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        if (0 == std::strcmp(argv[i], "-n")) {
+            opts.messages = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (0 == std::strcmp(argv[i], "-t")) {
+            opts.max_threads = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (0 == std::strcmp(argv[i], "-r")) {
+            opts.rate = std::strtod(argv[i + 1], nullptr);
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [-n messages] [-t max_threads] [-r rate]\n", argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    opts.messages = std::max<std::size_t>(opts.messages, 1);
+    opts.max_threads = std::max(opts.max_threads, 1u);
+    opts.rate = std::max(opts.rate, 1.0);
+    return opts;
+}
+
+// 1, 2, 4, ... max, always ending with max itself
+inline std::vector<unsigned> thread_counts(unsigned max) {
+    auto counts = std::vector<unsigned>();
+    for (auto n = 1u; n < max; n *= 2) counts.push_back(n);
+    counts.push_back(max);
+    return counts;
+}
+
+}
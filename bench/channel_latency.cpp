@@ -0,0 +1,114 @@
+#include <jjc/channel.hpp>
+
+#include "bench_help.hpp"
+#include "histogram.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <jjc/latch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures send-to-receive latency at a fixed offered load.
+//
+// Each producer follows a fixed schedule (rate / producers messages per
+// second). To correct for coordinated omission, the "corrected" latency is
+// measured from the time a message was *scheduled* to be sent rather than when
+// send() was actually called, so a producer that stalls inside send() is
+// charged for every message it was unable to send on time. The "raw" latency,
+// measured from the send() call, is reported alongside for comparison.
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+struct message {
+    std::int64_t intended;
+    std::int64_t sent;
+};
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(steady::now().time_since_epoch()).count();
+}
+
+std::string capacity_name(std::ptrdiff_t capacity) {
+    if (capacity == jjc::mpsc::unbounded) return "unbounded";
+    if (capacity == 0) return "rendezvous";
+    return "bounded " + std::to_string(capacity);
+}
+
+void print(const char* label, const bench::histogram& h) {
+    std::printf("  %-9s p50 %9.1f  p90 %9.1f  p99 %9.1f  p99.9 %9.1f  p99.99 %9.1f  max %9.1f (us)\n",
+        label,
+        static_cast<double>(h.percentile(50.0)) / 1e3,
+        static_cast<double>(h.percentile(90.0)) / 1e3,
+        static_cast<double>(h.percentile(99.0)) / 1e3,
+        static_cast<double>(h.percentile(99.9)) / 1e3,
+        static_cast<double>(h.percentile(99.99)) / 1e3,
+        static_cast<double>(h.max()) / 1e3
+    );
+}
+
+void run(std::ptrdiff_t capacity, unsigned producers, const bench::options& opts) {
+    const auto per_producer = std::max<std::size_t>(opts.messages / producers, 1);
+    const auto interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 * producers / opts.rate));
+
+    auto [send, recv] = jjc::mpsc::channel<message>(capacity);
+    jjc::latch start { producers + 1 };
+    auto epoch = std::int64_t{};
+
+    auto threads = std::vector<std::thread>(producers);
+    {
+        auto s = std::move(send);
+        for (auto& t : threads) t = std::thread([send = s, &start, &epoch, interval, per_producer]() mutable {
+            start.arrive_and_wait();
+            const auto t0 = steady::time_point(std::chrono::duration_cast<steady::duration>(std::chrono::nanoseconds(epoch)));
+            for (std::size_t i = 0; i < per_producer; ++i) {
+                const auto intended = t0 + interval * static_cast<std::int64_t>(i);
+                while (steady::now() < intended) std::this_thread::yield();
+                const auto sent = now_ns();
+                const auto scheduled = std::chrono::duration_cast<std::chrono::nanoseconds>(intended.time_since_epoch());
+                send.send(message { scheduled.count(), sent });
+            }
+        });
+    }
+
+    // The schedule starts slightly in the future so that all producers share
+    // one epoch.
+    epoch = now_ns() + 1000000;
+    start.arrive_and_wait();
+
+    auto corrected = bench::histogram{};
+    auto raw = bench::histogram{};
+    for (auto r = recv.receive(); r; r = recv.receive()) {
+        const auto received = now_ns();
+        corrected.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, received - r->intended)));
+        raw.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, received - r->sent)));
+    }
+    for (auto& t : threads) t.join();
+
+    std::printf("%s, %u producer(s), %.0f msgs/s offered, %llu messages\n",
+        capacity_name(capacity).c_str(),
+        producers,
+        opts.rate,
+        static_cast<unsigned long long>(corrected.count())
+    );
+    print("corrected", corrected);
+    print("raw", raw);
+    std::fflush(stdout);
+}
+
+}
+
+int main(int argc, char** argv) {
+    auto opts = bench::parse_options(argc, argv);
+
+    constexpr std::array<std::ptrdiff_t, 4> capacities = { jjc::mpsc::unbounded, 64, 1, 0 };
+    for (const auto capacity : capacities) {
+        for (const auto producers : bench::thread_counts(opts.max_threads)) {
+            run(capacity, producers, opts);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include <jjc/channel.hpp>
+
+#include "bench_help.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <jjc/latch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sweeps channel capacity, producer count, payload size and send mode, then
+// reports delivered messages per second and process CPU time per message.
+//
+// Every case sends the same number of messages regardless of producer count,
+// with the exception that very large payloads and rendezvous channels are
+// scaled down so that a full sweep stays reasonably short.
+
+namespace {
+
+using namespace std::chrono_literals;
+
+enum class mode { send, try_send, try_send_for };
+
+constexpr const char* mode_name(mode m) {
+    switch (m) {
+        case mode::send: return "send";
+        case mode::try_send: return "try_send";
+        case mode::try_send_for: return "try_send_for";
+    }
+    return "?";
+}
+
+std::string capacity_name(std::ptrdiff_t capacity) {
+    if (capacity == jjc::mpsc::unbounded) return "unbounded";
+    return std::to_string(capacity);
+}
+
+// Keep the amount of memory in flight bounded for unbounded channels.
+constexpr std::size_t max_bytes_in_flight = 64 << 20;
+
+template<typename T>
+void send_one(jjc::mpsc::sender<T>& s, T&& v, mode m) {
+    switch (m) {
+        case mode::send: {
+            s.send(std::move(v));
+            break;
+        }
+        case mode::try_send: {
+            auto r = s.try_send(std::move(v));
+            while (jjc::mpsc::status::WOULD_BLOCK == r) {
+                std::this_thread::yield();
+                r = s.try_send(std::move(*r.item));
+            }
+            break;
+        }
+        case mode::try_send_for: {
+            auto r = s.try_send_for(std::move(v), 1ms);
+            while (jjc::mpsc::status::TIMEOUT == r) {
+                r = s.try_send_for(std::move(*r.item), 1ms);
+            }
+            break;
+        }
+    }
+}
+
+template<typename T>
+void run(std::ptrdiff_t capacity, unsigned producers, mode m, std::size_t messages) {
+    if (capacity == 0 && m == mode::try_send) return; // never succeeds
+
+    if (capacity == 0) messages /= 16;
+    messages = std::min(messages, max_bytes_in_flight / sizeof(T));
+    const auto per_producer = std::max<std::size_t>(messages / producers, 1);
+    const auto total = per_producer * producers;
+
+    auto [send, recv] = jjc::mpsc::channel<T>(capacity);
+    jjc::latch start { producers + 1 };
+
+    auto threads = std::vector<std::thread>(producers);
+    {
+        auto s = std::move(send);
+        for (auto& t : threads) t = std::thread([send = s, &start, m, per_producer]() mutable {
+            start.arrive_and_wait();
+            for (std::size_t i = 0; i < per_producer; ++i) {
+                send_one(send, bench::make<T>(i), m);
+            }
+        });
+    }
+
+    auto watch = bench::stopwatch{};
+    start.arrive_and_wait();
+    watch.start();
+
+    std::size_t received = 0;
+    std::uint64_t checksum = 0;
+    for (auto r = recv.receive(); r; r = recv.receive()) {
+        checksum += bench::sequence(*r);
+        ++received;
+    }
+
+    const auto elapsed = watch.stop();
+    for (auto& t : threads) t.join();
+
+    const auto expected = producers * (per_producer * (per_producer - 1) / 2);
+    const auto ok = received == total && checksum == expected;
+    std::printf("%-10s %9u %8s %-13s %14.0f %12.1f%s\n",
+        capacity_name(capacity).c_str(),
+        producers,
+        bench::payload_name<T>().c_str(),
+        mode_name(m),
+        static_cast<double>(received) / elapsed.wall_seconds,
+        elapsed.cpu_seconds * 1e9 / static_cast<double>(received),
+        ok ? "" : "  (lost messages)"
+    );
+    std::fflush(stdout);
+}
+
+template<typename T>
+void sweep(const bench::options& opts) {
+    constexpr std::array<std::ptrdiff_t, 5> capacities = { jjc::mpsc::unbounded, 0, 1, 64, 4096 };
+    constexpr std::array<mode, 3> modes = { mode::send, mode::try_send, mode::try_send_for };
+
+    for (const auto capacity : capacities) {
+        for (const auto producers : bench::thread_counts(opts.max_threads)) {
+            for (const auto m : modes) {
+                run<T>(capacity, producers, m, opts.messages);
+            }
+        }
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    const auto opts = bench::parse_options(argc, argv);
+
+    std::printf("%-10s %9s %8s %-13s %14s %12s\n",
+        "capacity", "producers", "payload", "mode", "msgs/s", "cpu ns/msg");
+
+    sweep<int>(opts);
+    sweep<bench::payload<64>>(opts);
+    sweep<bench::payload<512>>(opts);
+    sweep<bench::payload<4096>>(opts);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace bench {
+
+// A log-bucketed histogram in the style of HdrHistogram.
+//
+// Values are split into power-of-two ranges, each of which is further split
+// into `half_count` linear sub-buckets. The relative error of any recorded
+// value is therefore bounded by 1 / half_count (~6%) across the full uint64_t
+// range, while recording stays a handful of integer ops with no allocation.
+class histogram {
+public:
+    void record(std::uint64_t v) noexcept {
+        ++_counts[index_of(v)];
+        ++_total;
+        _max = std::max(_max, v);
+    }
+
+    std::uint64_t count() const noexcept { return _total; }
+    std::uint64_t max() const noexcept { return _max; }
+
+    // Returns the highest value equivalent to the bucket containing the q-th
+    // quantile, i.e. percentiles are never under-reported.
+    std::uint64_t percentile(double q) const noexcept {
+        if (_total == 0) return 0;
+        const auto target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q / 100.0 * static_cast<double>(_total) + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < _counts.size(); ++i) {
+            seen += _counts[i];
+            if (seen >= target) return std::min(highest_equivalent(i), _max);
+        }
+        return _max;
+    }
+
+private:
+    static constexpr unsigned sub_bits = 5;
+    static constexpr std::uint64_t sub_count = 1 << sub_bits;
+    static constexpr std::uint64_t half_count = sub_count / 2;
+    static constexpr std::size_t bucket_count = (64 - sub_bits + 1) * half_count + half_count;
+
+    static unsigned msb(std::uint64_t v) noexcept {
+        auto n = 0u;
+        while (v >>= 1) ++n;
+        return n;
+    }
+
+    // Bucket 0 holds [0, sub_count) exactly. Bucket b > 0 holds
+    // [half_count << b, sub_count << b) in steps of 1 << b.
+    static std::size_t index_of(std::uint64_t v) noexcept {
+        const auto m = msb(v);
+        const auto b = m < sub_bits ? 0 : m - sub_bits + 1;
+        return static_cast<std::size_t>(b * half_count + (v >> b));
+    }
+
+    static std::uint64_t highest_equivalent(std::size_t i) noexcept {
+        const auto b = i < sub_count ? 0 : i / half_count - 1;
+        const auto sub = i - b * half_count;
+        return ((sub + 1) << b) - 1;
+    }
+
+    std::array<std::uint64_t, bucket_count> _counts = {};
+    std::uint64_t _total = 0;
+    std::uint64_t _max = 0;
+};
+
+}
@@ -0,0 +1,287 @@
+#include <jjc/barrier.hpp>
+#include <jjc/event.hpp>
+#include <jjc/latch.hpp>
+#include <jjc/mutex.hpp>
+#include <jjc/semaphore.hpp>
+#include <jjc/sharded_semaphore.hpp>
+#include <jjc/shared_mutex.hpp>
+
+#include "bench_help.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#if __has_include(<barrier>)
+#include <barrier>
+#endif
+#if __has_include(<latch>)
+#include <latch>
+#endif
+#if __has_include(<semaphore>)
+#include <semaphore>
+#endif
+
+// Uncontended and contended micro-benchmarks of the primitives, each paired
+// with its closest standard library equivalent.
+//
+// When built with JJC_BENCH_COUNT_FUTEX (GNU toolchains on Linux, see
+// CMakeLists.txt), calls into detail::concurrency::wait_impl, wait_until_impl,
+// wake_impl, wake_all_impl and requeue_impl are wrapped at link time and
+// counted, so each jjc result also reports how many times it entered the wait
+// layer per operation. Timed and untimed waits both count as waits, and a
+// requeue counts as a wake.
+
+namespace {
+
+std::atomic<std::uint64_t> wait_calls = { 0 };
+std::atomic<std::uint64_t> wake_calls = { 0 };
+
+#if defined(JJC_BENCH_COUNT_FUTEX)
+constexpr bool counting = true;
+#else
+constexpr bool counting = false;
+#endif
+
+}
+
+#if defined(JJC_BENCH_COUNT_FUTEX)
+extern "C" {
+
+int __real__ZN3jjc6detail11concurrency9wait_implEPvS2_(void*, void*) noexcept;
+int __real__ZN3jjc6detail11concurrency15wait_until_implEPvS2_RKNS1_8deadlineE(void*, void*, const jjc::detail::concurrency::deadline&) noexcept;
+int __real__ZN3jjc6detail11concurrency9wake_implEPvj(void*, uint32_t) noexcept;
+int __real__ZN3jjc6detail11concurrency13wake_all_implEPv(void*) noexcept;
+int __real__ZN3jjc6detail11concurrency12requeue_implEPvS2_S2_jj(void*, void*, void*, uint32_t, uint32_t) noexcept;
+
+int __wrap__ZN3jjc6detail11concurrency9wait_implEPvS2_(void* obj, void* expected) noexcept {
+    wait_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real__ZN3jjc6detail11concurrency9wait_implEPvS2_(obj, expected);
+}
+
+int __wrap__ZN3jjc6detail11concurrency15wait_until_implEPvS2_RKNS1_8deadlineE(void* obj, void* expected, const jjc::detail::concurrency::deadline& d) noexcept {
+    wait_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real__ZN3jjc6detail11concurrency15wait_until_implEPvS2_RKNS1_8deadlineE(obj, expected, d);
+}
+
+int __wrap__ZN3jjc6detail11concurrency9wake_implEPvj(void* obj, uint32_t count) noexcept {
+    wake_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real__ZN3jjc6detail11concurrency9wake_implEPvj(obj, count);
+}
+
+int __wrap__ZN3jjc6detail11concurrency13wake_all_implEPv(void* obj) noexcept {
+    wake_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real__ZN3jjc6detail11concurrency13wake_all_implEPv(obj);
+}
+
+int __wrap__ZN3jjc6detail11concurrency12requeue_implEPvS2_S2_jj(void* obj, void* expected, void* target, uint32_t wake_count, uint32_t requeue_count) noexcept {
+    wake_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real__ZN3jjc6detail11concurrency12requeue_implEPvS2_S2_jj(obj, expected, target, wake_count, requeue_count);
+}
+
+}
+#endif
+
+namespace {
+
+// A condition_variable based equivalent of jjc::event.
+struct std_event {
+    explicit std_event(bool signaled = false) : _signaled(signaled) {}
+
+    void signal() {
+        {
+            const auto lk = std::scoped_lock(_m);
+            _signaled = true;
+        }
+        _cv.notify_all();
+    }
+
+    void wait() {
+        auto lk = std::unique_lock(_m);
+        _cv.wait(lk, [this] { return _signaled; });
+        _signaled = false;
+    }
+
+private:
+    std::mutex _m;
+    std::condition_variable _cv;
+    bool _signaled;
+};
+
+// Runs body(thread_index, iterations) on each of `threads` threads, all
+// released at once, and reports the wall time per operation. The start gate
+// deliberately avoids the wait layer so that it doesn't pollute the counts.
+template<typename Body>
+void run(const char* name, unsigned threads, std::size_t iterations, bool is_jjc, Body&& body) {
+    std::atomic<unsigned> ready = { 0 };
+    std::atomic_bool go = { false };
+
+    auto workers = std::vector<std::thread>(threads);
+    for (auto i = 0u; i < threads; ++i) {
+        workers[i] = std::thread([&, i] {
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            body(i, iterations);
+        });
+    }
+    while (ready.load(std::memory_order_acquire) != threads) std::this_thread::yield();
+
+    wait_calls.store(0, std::memory_order_relaxed);
+    wake_calls.store(0, std::memory_order_relaxed);
+    auto watch = bench::stopwatch{};
+    watch.start();
+    go.store(true, std::memory_order_release);
+    for (auto& t : workers) t.join();
+    const auto elapsed = watch.stop();
+
+    const auto ops = static_cast<double>(iterations) * threads;
+    std::printf("%-28s %7u %10.1f", name, threads, elapsed.wall_seconds * 1e9 / ops);
+    if (counting && is_jjc) {
+        std::printf(" %10.4f %10.4f\n",
+            static_cast<double>(wait_calls.load(std::memory_order_relaxed)) / ops,
+            static_cast<double>(wake_calls.load(std::memory_order_relaxed)) / ops);
+    }
+    else {
+        std::printf(" %10s %10s\n", "-", "-");
+    }
+    std::fflush(stdout);
+}
+
+template<typename Mutex>
+void lock_unlock(const char* name, unsigned threads, std::size_t iterations, bool is_jjc) {
+    Mutex m;
+    alignas(64) std::uint64_t counter = 0;
+    run(name, threads, iterations, is_jjc, [&](unsigned, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            m.lock();
+            ++counter;
+            m.unlock();
+        }
+    });
+}
+
+// Mostly shared locks, with every 64th lock exclusive
+template<typename SharedMutex>
+void read_mostly(const char* name, unsigned threads, std::size_t iterations, bool is_jjc) {
+    SharedMutex m;
+    alignas(64) std::uint64_t counter = 0;
+    // keeps the reads from being optimized away
+    std::atomic<std::uint64_t> total = { 0 };
+    run(name, threads, iterations, is_jjc, [&](unsigned, std::size_t n) {
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % 64 == 63) {
+                m.lock();
+                ++counter;
+                m.unlock();
+            }
+            else {
+                m.lock_shared();
+                seen += counter;
+                m.unlock_shared();
+            }
+        }
+        total.fetch_add(seen, std::memory_order_relaxed);
+    });
+}
+
+template<typename Semaphore>
+void acquire_release(const char* name, unsigned threads, std::size_t iterations, std::ptrdiff_t permits, bool is_jjc) {
+    Semaphore s { permits };
+    run(name, threads, iterations, is_jjc, [&](unsigned, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            s.acquire();
+            s.release();
+        }
+    });
+}
+
+// Passes a token around a ring of threads, thread i waiting on event i and
+// signaling event i + 1. With one thread this is an uncontended signal/wait.
+template<typename Event>
+void signal_wait(const char* name, unsigned threads, std::size_t iterations, bool is_jjc) {
+    auto events = std::vector<std::unique_ptr<Event>>();
+    for (auto i = 0u; i < threads; ++i) events.push_back(std::make_unique<Event>(i == 0));
+    run(name, threads, iterations, is_jjc, [&](unsigned t, std::size_t n) {
+        auto& mine = *events[t];
+        auto& next = *events[(t + 1) % events.size()];
+        for (std::size_t i = 0; i < n; ++i) {
+            mine.wait();
+            next.signal();
+        }
+    });
+}
+
+// Every thread counts down and waits on a fresh latch per iteration.
+template<typename Latch>
+void count_down_wait(const char* name, unsigned threads, std::size_t iterations, bool is_jjc) {
+    auto latches = std::vector<std::unique_ptr<Latch>>();
+    for (std::size_t i = 0; i < iterations; ++i) latches.push_back(std::make_unique<Latch>(threads));
+    run(name, threads, iterations, is_jjc, [&](unsigned, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            latches[i]->count_down();
+            latches[i]->wait();
+        }
+    });
+}
+
+
+// Every thread arrives at the same barrier and waits for the others, once per
+// iteration, where a latch has to be made afresh each time
+template<typename Barrier, typename... Args>
+void arrive_wait(const char* name, unsigned threads, std::size_t iterations, bool is_jjc, Args... args) {
+    Barrier b { static_cast<std::ptrdiff_t>(threads), args... };
+    run(name, threads, iterations, is_jjc, [&](unsigned, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) b.arrive_and_wait();
+    });
+}
+
+}
+
+int main(int argc, char** argv) {
+    const auto opts = bench::parse_options(argc, argv);
+    const auto n = opts.messages;
+    // these hand off between threads on every op, so they are much slower
+    const auto n_handoff = std::max<std::size_t>(n / 16, 1);
+
+    std::printf("%-28s %7s %10s %10s %10s\n", "primitive", "threads", "ns/op", "waits/op", "wakes/op");
+
+    for (const auto threads : bench::thread_counts(opts.max_threads)) {
+        lock_unlock<jjc::mutex>("jjc::mutex", threads, n, true);
+        lock_unlock<std::mutex>("std::mutex", threads, n, false);
+
+        read_mostly<jjc::shared_mutex>("jjc::shared_mutex", threads, n, true);
+        read_mostly<std::shared_mutex>("std::shared_mutex", threads, n, false);
+
+        acquire_release<jjc::binary_semaphore>("jjc::binary_semaphore", threads, n, 1, true);
+#if defined(__cpp_lib_semaphore)
+        acquire_release<std::binary_semaphore>("std::binary_semaphore", threads, n, 1, false);
+#endif
+
+        const auto permits = static_cast<std::ptrdiff_t>(std::max(1u, threads / 2));
+        acquire_release<jjc::counting_semaphore<>>("jjc::counting_semaphore", threads, n, permits, true);
+#if defined(__cpp_lib_semaphore)
+        acquire_release<std::counting_semaphore<>>("std::counting_semaphore", threads, n, permits, false);
+#endif
+        acquire_release<jjc::sharded_semaphore>("jjc::sharded_semaphore", threads, n, permits, true);
+
+        signal_wait<jjc::event>("jjc::event", threads, n_handoff, true);
+        signal_wait<std_event>("std::condition_variable", threads, n_handoff, false);
+
+        count_down_wait<jjc::latch>("jjc::latch", threads, n_handoff, true);
+#if defined(__cpp_lib_latch)
+        count_down_wait<std::latch>("std::latch", threads, n_handoff, false);
+#endif
+
+        arrive_wait<jjc::barrier<>>("jjc::barrier (counter)", threads, n_handoff, true, jjc::barrier_arrival::COUNTER);
+        arrive_wait<jjc::barrier<>>("jjc::barrier (tree)", threads, n_handoff, true, jjc::barrier_arrival::TREE);
+#if defined(__cpp_lib_barrier)
+        arrive_wait<std::barrier<>>("std::barrier", threads, n_handoff, false);
+#endif
+    }
+}
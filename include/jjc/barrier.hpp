@@ -0,0 +1,188 @@
+#ifndef JJC_BARRIER_HPP
+#define JJC_BARRIER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <jjc/detail/spin.hpp>
+#include <jjc/detail/wait.hpp>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace jjc {
+
+// How a barrier counts the arrivals in each phase
+enum class barrier_arrival {
+    // Every arrival counts down one shared word
+    COUNTER,
+    // Arrivals pair up in a tree of nodes, each on a cache line of its own.
+    // The first of each pair stops at the node, and only the second carries on
+    // up, so no word sees more than two arrivals per phase.
+    TREE
+};
+
+namespace detail {
+
+struct noop_completion {
+    void operator()() noexcept {}
+};
+
+}
+
+// An implementation of C++20's `barrier`.
+//
+// Waiters park on the phase word, and only the arrival that completes a phase
+// wakes them, and only if one of them actually parked.
+//
+// In a tree, each node holds one ticket per level, and a ticket steps from the
+// phase to a half step when the first of a pair arrives, then to the next phase
+// when the second does. An arrival starts at a node picked by its thread and
+// moves on to the next node if that one is already full. With an odd number
+// of arrivals at a level, the last node takes just one. The arrival that gets
+// past the top level completes the phase.
+template<typename CompletionFunction = detail::noop_completion>
+class barrier {
+public:
+    class arrival_token {
+    private:
+        friend barrier;
+
+        explicit arrival_token(uint32_t phase) noexcept :
+            _phase(phase)
+        {}
+
+        uint32_t _phase;
+    };
+
+    static constexpr std::ptrdiff_t max() noexcept {
+        return std::numeric_limits<int32_t>::max();
+    }
+
+    // Above this many threads, the first constructor arrives through a tree
+    static constexpr std::ptrdiff_t tree_threshold = 8;
+
+    explicit barrier(std::ptrdiff_t expected, CompletionFunction f = CompletionFunction()) :
+        barrier(expected, expected > tree_threshold ? barrier_arrival::TREE : barrier_arrival::COUNTER, std::move(f))
+    {}
+
+    barrier(std::ptrdiff_t expected, barrier_arrival arrival, CompletionFunction f = CompletionFunction()) :
+        _expected(expected),
+        _remaining(expected),
+        _nodes(barrier_arrival::TREE == arrival ? std::make_unique<node[]>(static_cast<std::size_t>(expected + 1) / 2) : nullptr),
+        _completion(std::move(f))
+    {
+        assert(expected >= 0 && expected <= max());
+    }
+
+    barrier(const barrier&) = delete;
+
+    barrier& operator =(const barrier&) = delete;
+
+    [[nodiscard]] arrival_token arrive(std::ptrdiff_t update = 1) {
+        assert(update > 0);
+        const auto phase = _phase.load(std::memory_order_acquire) & ~parked;
+        if (_nodes == nullptr) {
+            if (update == _remaining.fetch_sub(update, std::memory_order_acq_rel)) complete(phase);
+        }
+        else {
+            for (; update != 0; --update) {
+                if (arrive_at_node(phase)) complete(phase);
+            }
+        }
+        return arrival_token(phase);
+    }
+
+    void wait(arrival_token&& arrival) const {
+        const auto phase = arrival._phase;
+        const auto done = [&] { return (_phase.load(std::memory_order_acquire) & ~parked) != phase; };
+        if (done() || _spin.spin(done)) return;
+
+        auto cur = _phase.load(std::memory_order_acquire);
+        while ((cur & ~parked) == phase) {
+            if ((cur & parked) == 0 && !_phase.compare_exchange_weak(cur, cur | parked, std::memory_order_acquire)) continue;
+            detail::concurrency::wait(&_phase, cur | parked);
+            cur = _phase.load(std::memory_order_acquire);
+        }
+    }
+
+    void arrive_and_wait() {
+        wait(arrive());
+    }
+
+    void arrive_and_drop() {
+        // published to the completing arrival by this thread's own arrival
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        (void)arrive();
+    }
+
+private:
+    // Phases step by 2, leaving the low bit to mark that a waiter has parked
+    static constexpr uint32_t parked = 1;
+
+    struct alignas(64) node {
+        // One per level of the tree, which is never as deep as this
+        std::atomic<uint8_t> tickets[64] = {};
+    };
+
+    static std::size_t start_node() noexcept {
+        return std::hash<std::thread::id>{}(std::this_thread::get_id());
+    }
+
+    // Returns true if this arrival completes the phase
+    bool arrive_at_node(uint32_t phase) {
+        const auto old_step = static_cast<uint8_t>(phase);
+        const auto half_step = static_cast<uint8_t>(old_step + 1);
+        const auto full_step = static_cast<uint8_t>(old_step + 2);
+
+        auto arrivals = static_cast<std::size_t>(_expected);
+        auto current = start_node() % ((arrivals + 1) / 2);
+        for (std::size_t level = 0; arrivals > 1; ++level) {
+            const auto end = (arrivals + 1) / 2;
+            const auto last = end - 1;
+            for (;; ++current) {
+                if (current == end) current = 0;
+                auto& ticket = _nodes[current].tickets[level];
+                auto seen = old_step;
+                if (current == last && (arrivals & 1) != 0) {
+                    // the odd one out goes straight on up
+                    if (ticket.compare_exchange_strong(seen, full_step, std::memory_order_acq_rel)) break;
+                }
+                else if (ticket.compare_exchange_strong(seen, half_step, std::memory_order_acq_rel)) {
+                    return false;
+                }
+                else if (seen == half_step && ticket.compare_exchange_strong(seen, full_step, std::memory_order_acq_rel)) {
+                    break;
+                }
+            }
+            arrivals = end;
+            current /= 2;
+        }
+        return true;
+    }
+
+    void complete(uint32_t phase) {
+        _completion();
+        _expected -= _dropped.exchange(0, std::memory_order_relaxed);
+        _remaining.store(_expected, std::memory_order_relaxed);
+        if (_phase.exchange(phase + 2, std::memory_order_release) & parked) {
+            detail::concurrency::wake_all(&_phase);
+        }
+    }
+
+    mutable std::atomic_uint32_t _phase = { 0 };
+    // Only changed by the arrival that completes a phase, before the next one
+    std::ptrdiff_t _expected;
+    alignas(64) std::atomic_ptrdiff_t _remaining;
+    std::atomic_ptrdiff_t _dropped = { 0 };
+    const std::unique_ptr<node[]> _nodes;
+    CompletionFunction _completion;
+    mutable detail::concurrency::adaptive_spin _spin = {};
+};
+
+}
+
+#endif//JJC_BARRIER_HPP
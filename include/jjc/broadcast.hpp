@@ -0,0 +1,249 @@
+#ifndef JJC_BROADCAST_HPP
+#define JJC_BROADCAST_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/channel.hpp>
+#include <jjc/detail/broadcast_channel.hpp>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace jjc::broadcast {
+
+using mpsc::blocking;
+using mpsc::invalid_capacity;
+using mpsc::send_result;
+using mpsc::status;
+
+struct options {
+    /**
+     * What happens once a receiver is a whole ring behind the sender
+     */
+    lag_policy on_lag = lag_policy::BLOCK;
+
+    /**
+     * Where the channel allocates its memory: the channel itself, its ring and
+     * every item sent. Null means std::pmr::get_default_resource(). Items are
+     * freed by whichever thread drops the last view of them, so the resource
+     * must be thread-safe, and must outlive every handle and every view.
+     */
+    std::pmr::memory_resource* resource = nullptr;
+};
+
+template<typename T>
+struct sender;
+
+template<typename T>
+struct receiver;
+
+/**
+ * A read-only view of an item. Every receiver gets a view of the same stored
+ * item, so nothing is copied, and the item lives for as long as any view of it
+ * or the sender has yet to replace it.
+ */
+template<typename T>
+using view = std::shared_ptr<const T>;
+
+/**
+ * As jjc::mpsc::recv_result, except that under lag_policy::SKIP the result may
+ * be LAGGED. In that case the receiver has moved on to the oldest item still
+ * available, and `skipped` says how many it missed.
+ */
+template<typename T>
+struct recv_result : std::optional<view<T>> {
+    status result;
+    std::uint64_t skipped = 0;
+
+    recv_result(view<T>&& v) : std::optional<view<T>>(std::move(v)), result(status::OK) {}
+    recv_result(status s, std::uint64_t n = 0) : std::optional<view<T>>(), result(s), skipped(n) {}
+};
+
+/**
+ * Creates a single-ring broadcast channel, in which every receiver sees every
+ * item sent after it was created. Copying a receiver adds another receiver
+ * that starts from the same position.
+ * 
+ * Items are stored once, in a ring of `capacity` slots, and receivers get
+ * shared read-only views of them. What happens when a receiver falls a whole ring
+ * behind depends on options::on_lag.
+ * 
+ * The channel is closed once every receiver is gone, and disconnected once
+ * every sender is. A capacity less than 1 throws jjc::broadcast::invalid_capacity.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T>
+auto channel(std::ptrdiff_t capacity, const options& opts = {}) -> std::pair<sender<T>, receiver<T>>;
+
+template<typename T>
+struct sender {
+    send_result<T> send(T&& v) {
+        return _channel->send(std::move(v), true, nullptr);
+    }
+
+    send_result<T> send(const T& v) {
+        auto r = send(T(v));
+        r.item.reset();
+        return r;
+    }
+
+    /**
+     * Fails with WOULD_BLOCK if a slow receiver or another sender is in the
+     * way.
+     */
+    send_result<T> try_send(T&& v) {
+        return _channel->send(std::move(v), false, nullptr);
+    }
+
+    send_result<T> try_send(const T& v) {
+        auto r = try_send(T(v));
+        r.item.reset();
+        return r;
+    }
+
+    template<typename Rep, typename Period>
+    send_result<T> try_send_for(T&& v, const std::chrono::duration<Rep, Period>& timeout_after) {
+        const auto tp = std::chrono::steady_clock::now() + timeout_after;
+        return _channel->send(std::move(v), true, &tp);
+    }
+
+    template<typename Clock, typename Duration>
+    send_result<T> try_send_until(T&& v, const std::chrono::time_point<Clock, Duration>& timeout_at) {
+        return try_send_for(std::move(v), timeout_at - Clock::now());
+    }
+
+    send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& timeout_at) {
+        return _channel->send(std::move(v), true, &timeout_at);
+    }
+
+    blocking blocks() const noexcept {
+        return lag_policy::BLOCK == _channel->policy() ? blocking::SOMETIMES : blocking::NEVER;
+    }
+
+    ~sender() {
+        if (_channel) _channel->disconnect();
+    }
+
+    sender(sender&&) noexcept = default;
+
+    sender& operator=(sender&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->disconnect();
+            _channel = std::move(rhs._channel);
+        }
+        return *this;
+    }
+
+    sender(const sender& other) noexcept :
+        _channel(other._channel)
+    {
+        _channel->connect();
+    }
+
+    sender& operator=(const sender& rhs) noexcept {
+        if (this != &rhs) *this = sender(rhs);
+        return *this;
+    }
+
+private:
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+
+    explicit sender(std::shared_ptr<detail::channel<T>> ch) :
+        _channel(std::move(ch))
+    {}
+
+    std::shared_ptr<detail::channel<T>> _channel;
+};
+
+template<typename T>
+struct receiver {
+    recv_result<T> receive() {
+        auto r = try_receive();
+        while (status::WOULD_BLOCK == r.result) {
+            _channel->wait_for_item(*_cursor, nullptr);
+            r = try_receive();
+        }
+        return r;
+    }
+
+    recv_result<T> try_receive() {
+        auto t = _channel->take(*_cursor);
+        if (status::OK == t.result) return { std::move(t.item) };
+        return { t.result, t.skipped };
+    }
+
+    template<typename Rep, typename Period>
+    recv_result<T> try_receive_for(const std::chrono::duration<Rep, Period>& timeout_after) {
+        return try_receive_until(std::chrono::steady_clock::now() + timeout_after);
+    }
+
+    template<typename Clock, typename Duration>
+    recv_result<T> try_receive_until(const std::chrono::time_point<Clock, Duration>& timeout_at) {
+        return try_receive_for(timeout_at - Clock::now());
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& timeout_at) {
+        auto r = try_receive();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!_channel->wait_for_item(*_cursor, &timeout_at)) return { status::TIMEOUT };
+            r = try_receive();
+        }
+        return r;
+    }
+
+    blocking blocks() const noexcept {
+        return blocking::SOMETIMES;
+    }
+
+    ~receiver() {
+        if (_channel) _channel->unsubscribe(_cursor.get());
+    }
+
+    receiver(receiver&&) noexcept = default;
+
+    receiver& operator=(receiver&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->unsubscribe(_cursor.get());
+            _channel = std::move(rhs._channel);
+            _cursor = std::move(rhs._cursor);
+        }
+        return *this;
+    }
+
+    receiver(const receiver& other) :
+        _channel(other._channel),
+        _cursor(_channel->subscribe(other._cursor->next.load(std::memory_order_relaxed)))
+    {}
+
+    receiver& operator=(const receiver& rhs) {
+        if (this != &rhs) *this = receiver(rhs);
+        return *this;
+    }
+
+private:
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+
+    explicit receiver(std::shared_ptr<detail::channel<T>> ch) :
+        _channel(std::move(ch)),
+        _cursor(_channel->subscribe(0))
+    {}
+
+    std::shared_ptr<detail::channel<T>> _channel;
+    std::unique_ptr<detail::cursor> _cursor;
+};
+
+template<typename T>
+auto channel(std::ptrdiff_t capacity, const options& opts) -> std::pair<sender<T>, receiver<T>> {
+    if (capacity <= 0) throw invalid_capacity();
+    const auto resource = mpsc::detail::resource_or_default(opts.resource);
+    auto ch = mpsc::detail::allocate_channel<detail::channel<T>>(resource, static_cast<std::size_t>(capacity), opts.on_lag, resource);
+    auto r = receiver<T>(ch);
+    return { sender<T>(std::move(ch)), std::move(r) };
+}
+
+}
+
+#endif//JJC_BROADCAST_HPP
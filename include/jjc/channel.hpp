@@ -2,13 +2,22 @@
 #define JJC_CONCURRENCY_CHANNEL_HPP
 
 #include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <jjc/detail/mpmc_unbounded.hpp>
 #include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/mpsc_handle.hpp>
 #include <jjc/detail/mpsc_bounded.hpp>
+#include <jjc/detail/mpsc_laned.hpp>
 #include <jjc/detail/mpsc_rendezvous.hpp>
+#include <jjc/detail/mpsc_segmented.hpp>
 #include <jjc/detail/mpsc_unbounded.hpp>
+#include <jjc/detail/spsc_channel.hpp>
 #include <limits>
 #include <memory>
+#include <memory_resource>
 #include <optional>
+#include <utility>
 
 namespace jjc::mpsc {
 
@@ -24,6 +33,49 @@ struct invalid_capacity : std::logic_error {
     invalid_capacity() : std::logic_error("invalid channel capacity") {}
 };
 
+/**
+ * Tuning knobs for a channel. Options that don't apply to the selected channel
+ * type are ignored.
+ */
+struct options {
+    /**
+     * The number of consumed nodes an unbounded channel keeps around for reuse
+     * by producers. Anything beyond that is freed, letting memory shrink after
+     * a burst. 0 disables recycling entirely.
+     */
+    std::size_t pool_high_water = detail::default_pool_high_water;
+
+    /**
+     * If non-zero, an unbounded channel stores items in linked segments of
+     * this many slots rather than one heap node per item. That means one
+     * allocation per segment and contiguous reads for the receiver, at the
+     * cost of `segment_size` slots of memory that may sit unused. Values
+     * between 32 and 1024 are sensible.
+     */
+    std::size_t segment_size = 0;
+
+    /**
+     * If true, an unbounded channel gives every sender handle (including each
+     * copy) a single-producer lane of its own, so senders never contend with
+     * each other. The receiver takes from the lanes in turn. Items from one
+     * sender arrive in the order they were sent, but there is no ordering
+     * between senders. Lanes are segmented, with `segment_size` slots per
+     * segment or 64 if that is 0.
+     */
+    bool per_sender_lanes = false;
+
+    /**
+     * Where the channel allocates its memory, both the channel itself and any
+     * nodes, segments or slots it needs later. Null means
+     * std::pmr::get_default_resource(). The resource must outlive every
+     * handle to the channel. Senders allocate and the receiver frees on their
+     * own threads, so the resource must be thread-safe (such as
+     * std::pmr::synchronized_pool_resource) unless only one thread at a time
+     * uses the channel.
+     */
+    std::pmr::memory_resource* resource = nullptr;
+};
+
 /**
  * Creates a multi-producer, single-consumer FIFO for cross-thread message
  * passing.
@@ -40,183 +92,490 @@ struct invalid_capacity : std::logic_error {
  * * Anything else - throws jjc::mpsc::invalid_capacity
  * 
  * @param capacity jjc::mpsc::unbounded by default
+ * @param opts see jjc::mpsc::options
  * @returns sender/receiver pair
  */
 template<typename T>
-auto channel(std::ptrdiff_t capacity = unbounded) -> std::pair<sender<T>, receiver<T>>;
+auto channel(std::ptrdiff_t capacity = unbounded, const options& opts = {}) -> std::pair<sender<T>, receiver<T>>;
 
-template<typename T>
-struct sender {
-    send_result<T> send(T&& v) {
-        return _channel->send(std::move(v));
-    }
+/**
+ * Creates a bounded channel whose capacity is fixed at compile time. The slots
+ * are stored inline with the channel, and a power-of-two capacity turns every
+ * index calculation into a mask.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T, std::size_t Capacity>
+auto channel(const options& opts = {}) -> std::pair<sender<T>, receiver<T>>;
 
-    send_result<T> send(const T& v) {
-        return _channel->send(v);
-    }
+/**
+ * The channel types that can be chosen at compile time
+ */
+enum class kind {
+    // one node per item, see options::pool_high_water
+    unbounded,
+    // unbounded, in linked segments of options::segment_size slots (or 64)
+    segmented,
+    bounded,
+    rendezvous
+};
 
-    send_result<T> try_send(T&& v) {
-        return _channel->try_send(std::move(v));
-    }
+template<typename T, kind K>
+struct static_sender;
 
-    send_result<T> try_send(const T& v) {
-        return _channel->try_send(v);
-    }
+template<typename T, kind K>
+struct static_receiver;
 
-    template<typename Rep, typename Period>
-    send_result<T> try_send_for(T&& v, const std::chrono::duration<Rep, Period>& timeout_after) {
-        const auto tp = std::chrono::steady_clock::now() + timeout_after;
-        return _channel->try_send_until(std::move(v), tp);
-    }
+/**
+ * Creates a channel whose type is fixed at compile time. The handles refer to
+ * the channel directly rather than through std::shared_ptr and a virtual
+ * interface, so sends and receives can be inlined, and copying or dropping a
+ * sender is a single atomic update. The handles otherwise behave as
+ * jjc::mpsc::sender and jjc::mpsc::receiver do.
+ * 
+ * kind::bounded takes a capacity instead, through the overload below.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T, kind K>
+auto channel(const options& opts = {}) -> std::pair<static_sender<T, K>, static_receiver<T, K>>;
 
-    template<typename Rep, typename Period>
-    send_result<T> try_send_for(const T& v, const std::chrono::duration<Rep, Period>& timeout_after) {
-        const auto tp = std::chrono::steady_clock::now() + timeout_after;
-        return _channel->try_send_until(v, tp);
-    }
+/**
+ * As above, for kind::bounded. A capacity less than 1 throws
+ * jjc::mpsc::invalid_capacity.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T, kind K>
+auto channel(std::ptrdiff_t capacity, const options& opts = {}) -> std::pair<static_sender<T, K>, static_receiver<T, K>>;
 
-    template<typename Clock, typename Duration>
-    send_result<T> try_send_until(T&& v, const std::chrono::time_point<Clock, Duration>& timeout_at) {
-        const auto d = timeout_at - Clock::now();
-        return try_send_for(std::move(v), d);
-    }
+}
 
-    send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& timeout_at) {
-        return _channel->try_send_until(std::move(v), timeout_at);
-    }
+namespace jjc::spsc {
 
-    template<typename Clock, typename Duration>
-    send_result<T> try_send_until(const T& v, const std::chrono::time_point<Clock, Duration>& timeout_at) {
-        const auto d = timeout_at - Clock::now();
-        return try_send_for(v, d);
-    }
+template<typename T>
+struct sender;
 
-    send_result<T> try_send_until(const T& v, const std::chrono::steady_clock::time_point& timeout_at) {
-        return _channel->try_send_until(v, timeout_at);
-    }
+template<typename T>
+using receiver = mpsc::receiver<T>;
 
-    blocking blocks() const noexcept {
-        return _channel->send_blocks();
-    }
+/**
+ * Creates a single-producer, single-consumer FIFO. The sender is move-only,
+ * which lets the channel publish items with plain stores rather than the CAS
+ * loops multiple producers need.
+ * 
+ * Capacity and options are interpreted as for jjc::mpsc::channel, except that
+ * the unbounded channel always uses segments (of options::segment_size slots,
+ * if non-zero). A capacity of 0 gives the same rendezvous channel as
+ * jjc::mpsc::channel.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T>
+auto channel(std::ptrdiff_t capacity = mpsc::unbounded, const mpsc::options& opts = {}) -> std::pair<sender<T>, receiver<T>>;
+
+}
+
+namespace jjc::mpmc {
+
+template<typename T>
+using sender = mpsc::sender<T>;
+
+template<typename T>
+struct receiver;
+
+/**
+ * Creates a multi-producer, multi-consumer FIFO for spreading work across
+ * threads. Receivers can be copied like senders, and each item is received by
+ * exactly one of them. The channel is closed once every receiver is gone, and
+ * disconnected once every sender is.
+ * 
+ * The capacity is either jjc::mpmc::unbounded, for a channel of linked
+ * segments (of options::segment_size slots, if non-zero), or greater than 0
+ * for a ring of that many slots. Anything else throws
+ * jjc::mpmc::invalid_capacity.
+ * 
+ * @returns sender/receiver pair
+ */
+template<typename T>
+auto channel(std::ptrdiff_t capacity = mpsc::unbounded, const mpsc::options& opts = {}) -> std::pair<sender<T>, receiver<T>>;
+
+}
+
+namespace jjc::mpsc {
 
+template<typename T>
+struct sender : detail::sender_handle<T, std::shared_ptr<detail::sender<T>>> {
     ~sender() {
         if (_channel) _channel->disconnect();
     }
 
     sender(sender&&) noexcept = default;
-    sender& operator=(sender&&) noexcept = default;
 
-    sender(const sender& other) noexcept :
-        _channel(other._channel)
-    {
-        _channel->connect();
+    sender& operator=(sender&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->disconnect();
+            _channel = std::move(rhs._channel);
+        }
+        return *this;
     }
 
-    sender& operator=(const sender& rhs) noexcept {
-        _channel = rhs._channel;
-        _channel->connect();
+    sender(const sender& other) :
+        handle(other._channel->fork(other._channel))
+    {}
+
+    sender& operator=(const sender& rhs) {
+        if (this != &rhs) {
+            auto ch = rhs._channel->fork(rhs._channel);
+            if (_channel) _channel->disconnect();
+            _channel = std::move(ch);
+        }
         return *this;
     }
 
 private:
-    friend auto channel<T>(std::ptrdiff_t) -> std::pair<sender<T>, receiver<T>>;
+    using handle = detail::sender_handle<T, std::shared_ptr<detail::sender<T>>>;
+    using handle::_channel;
+
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+    template<typename U, std::size_t Capacity>
+    friend auto channel(const options&) -> std::pair<sender<U>, receiver<U>>;
+    template<typename U>
+    friend struct spsc::sender;
+    template<typename U>
+    friend auto mpmc::channel(std::ptrdiff_t, const mpsc::options&) -> std::pair<mpmc::sender<U>, mpmc::receiver<U>>;
 
     explicit sender(std::shared_ptr<detail::sender<T>> ch) :
-        _channel(std::move(ch))
+        handle(std::move(ch))
     {}
-
-    std::shared_ptr<detail::sender<T>> _channel;
 };
 
 template<typename T>
-struct receiver {
-    recv_result<T> receive() {
-        return _channel->receive();
+struct receiver : detail::receiver_handle<T, std::shared_ptr<detail::receiver<T>>> {
+    ~receiver() {
+        if (_channel) _channel->close();
     }
 
-    recv_result<T> try_receive() {
-        return _channel->try_receive();
+    receiver(receiver&&) noexcept = default;
+    receiver(const receiver&) = delete;
+    receiver& operator=(const receiver&) = delete;
+
+    receiver& operator=(receiver&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->close();
+            _channel = std::move(rhs._channel);
+        }
+        return *this;
     }
 
-    template<typename Rep, typename Period>
-    recv_result<T> try_receive_for(const std::chrono::duration<Rep, Period>& timeout_after) {
-        const auto tp = std::chrono::steady_clock::now() + timeout_after;
-        return _channel->try_receive_until(tp);
+private:
+    using handle = detail::receiver_handle<T, std::shared_ptr<detail::receiver<T>>>;
+    using handle::_channel;
+
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+    template<typename U, std::size_t Capacity>
+    friend auto channel(const options&) -> std::pair<sender<U>, receiver<U>>;
+    template<typename U>
+    friend auto spsc::channel(std::ptrdiff_t, const mpsc::options&) -> std::pair<spsc::sender<U>, spsc::receiver<U>>;
+    template<typename U>
+    friend struct mpmc::receiver;
+    friend struct detail::select_access;
+
+    explicit receiver(std::shared_ptr<detail::receiver<T>> ch) :
+        handle(std::move(ch))
+    {}
+};
+
+template<typename T>
+auto channel(std::ptrdiff_t capacity, const options& opts) -> std::pair<sender<T>, receiver<T>> {
+    const auto resource = detail::resource_or_default(opts.resource);
+    if (capacity == unbounded && opts.per_sender_lanes) {
+        const auto segment_size = opts.segment_size != 0 ? opts.segment_size : spsc::detail::default_segment_size;
+        auto ch = detail::allocate_channel<detail::laned_channel<T>>(resource, segment_size, resource);
+        auto chs = std::shared_ptr<detail::sender<T>>(ch, ch->first_lane());
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(ch)) };
+    }
+    else if (capacity == unbounded && opts.segment_size > 0) {
+        auto chs = detail::allocate_channel<detail::segmented_channel<T>>(resource, opts.segment_size, resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+    }
+    else if (capacity == unbounded) {
+        auto chs = detail::allocate_channel<detail::unbounded_channel<T>>(resource, opts.pool_high_water, resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+    }
+    else if (capacity == 0) {
+        auto chs = detail::allocate_channel<detail::rendezvous_channel<T>>(resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+    }
+    else if (capacity > 0) {
+        auto chs = detail::allocate_channel<detail::bounded_channel<T>>(resource, static_cast<std::size_t>(capacity), resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
     }
+    throw invalid_capacity();
+}
+
+template<typename T, std::size_t Capacity>
+auto channel(const options& opts) -> std::pair<sender<T>, receiver<T>> {
+    static_assert(Capacity > 0, "use jjc::mpsc::channel<T>(0) for a rendezvous channel");
+    auto chs = detail::allocate_channel<detail::bounded_channel<T, Capacity>>(detail::resource_or_default(opts.resource));
+    auto chr = chs;
+    return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+}
+
+namespace detail {
+
+template<typename T, kind K>
+struct kind_channel;
+
+template<typename T>
+struct kind_channel<T, kind::unbounded> { using type = unbounded_channel<T>; };
+
+template<typename T>
+struct kind_channel<T, kind::segmented> { using type = segmented_channel<T>; };
+
+template<typename T>
+struct kind_channel<T, kind::bounded> { using type = bounded_channel<T>; };
+
+template<typename T>
+struct kind_channel<T, kind::rendezvous> { using type = rendezvous_channel<T>; };
+
+template<typename T, kind K>
+using static_channel = counted<typename kind_channel<T, K>::type>;
+
+}
 
-    template<typename Clock, typename Duration>
-    recv_result<T> try_receive_until(const std::chrono::time_point<Clock, Duration>& timeout_at) {
-        const auto d = timeout_at - Clock::now();
-        return try_receive_for(d);
+template<typename T, kind K>
+struct static_sender : detail::sender_handle<T, detail::static_channel<T, K>*> {
+    ~static_sender() {
+        if (_channel) _channel->drop_sender();
     }
 
-    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& timeout_at) {
-        return _channel->try_receive_until(timeout_at);
+    static_sender(static_sender&& other) noexcept :
+        handle(std::exchange(other._channel, nullptr))
+    {}
+
+    static_sender& operator=(static_sender&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->drop_sender();
+            _channel = std::exchange(rhs._channel, nullptr);
+        }
+        return *this;
     }
 
-    blocking blocks() const noexcept {
-        return _channel->recv_blocks();
+    static_sender(const static_sender& other) noexcept :
+        handle(other._channel)
+    {
+        _channel->add_sender();
     }
 
-    ~receiver() {
-        if (_channel) _channel->close();
+    static_sender& operator=(const static_sender& rhs) noexcept {
+        if (this != &rhs) *this = static_sender(rhs);
+        return *this;
     }
 
-    receiver(receiver&&) noexcept = default;
-    receiver(const receiver&) = delete;
-    receiver& operator=(receiver&&) noexcept = default;
-    receiver& operator=(const receiver&) = delete;
+private:
+    using handle = detail::sender_handle<T, detail::static_channel<T, K>*>;
+    using handle::_channel;
 
-    struct iterator {
-        T& operator *() { return *_result; }
-        iterator& operator++() { _result = _channel->receive(); return *this; }
-        bool operator!=(const iterator& rhs) { return _result.has_value() || rhs._result.has_value(); }
-
-    private:
-        friend iterator begin(receiver& r);
-        friend constexpr iterator end(const receiver&) noexcept;
-        constexpr iterator() noexcept = default;
-        constexpr iterator(detail::receiver<T>* channel, recv_result<T> result) noexcept :
-            _channel(channel),
-            _result(std::move(result))
-        {}
-        detail::receiver<T>* _channel = nullptr;
-        recv_result<T> _result = { status::CLOSED };
-    };
+    template<typename U, kind L>
+    friend auto channel(const options&) -> std::pair<static_sender<U, L>, static_receiver<U, L>>;
+    template<typename U, kind L>
+    friend auto channel(std::ptrdiff_t, const options&) -> std::pair<static_sender<U, L>, static_receiver<U, L>>;
 
-private:
-    friend auto channel<T>(std::ptrdiff_t) -> std::pair<sender<T>, receiver<T>>;
+    explicit static_sender(detail::static_channel<T, K>* ch) noexcept :
+        handle(ch)
+    {}
+};
 
-    friend iterator begin(receiver& r) {
-        auto item = r.receive();
-        return { r._channel.get(), std::move(item) };
+template<typename T, kind K>
+struct static_receiver : detail::receiver_handle<T, detail::static_channel<T, K>*> {
+    ~static_receiver() {
+        if (_channel) _channel->drop_receiver();
     }
 
-    friend constexpr iterator end(const receiver&) noexcept {
-        return {};
+    static_receiver(static_receiver&& other) noexcept :
+        handle(std::exchange(other._channel, nullptr))
+    {}
+
+    static_receiver(const static_receiver&) = delete;
+    static_receiver& operator=(const static_receiver&) = delete;
+
+    static_receiver& operator=(static_receiver&& rhs) noexcept {
+        if (this != &rhs) {
+            if (_channel) _channel->drop_receiver();
+            _channel = std::exchange(rhs._channel, nullptr);
+        }
+        return *this;
     }
 
-    explicit receiver(std::shared_ptr<detail::receiver<T>> ch) :
-        _channel(std::move(ch))
+private:
+    using handle = detail::receiver_handle<T, detail::static_channel<T, K>*>;
+    using handle::_channel;
+
+    template<typename U, kind L>
+    friend auto channel(const options&) -> std::pair<static_sender<U, L>, static_receiver<U, L>>;
+    template<typename U, kind L>
+    friend auto channel(std::ptrdiff_t, const options&) -> std::pair<static_sender<U, L>, static_receiver<U, L>>;
+
+    explicit static_receiver(detail::static_channel<T, K>* ch) noexcept :
+        handle(ch)
     {}
+};
+
+template<typename T, kind K>
+auto channel(const options& opts) -> std::pair<static_sender<T, K>, static_receiver<T, K>> {
+    static_assert(K != kind::bounded, "kind::bounded needs a capacity");
+    using channel_type = detail::static_channel<T, K>;
+    const auto resource = detail::resource_or_default(opts.resource);
+    channel_type* ch = nullptr;
+    if constexpr (K == kind::unbounded) {
+        ch = channel_type::make(resource, opts.pool_high_water, resource);
+    }
+    else if constexpr (K == kind::segmented) {
+        const auto segment_size = opts.segment_size != 0 ? opts.segment_size : spsc::detail::default_segment_size;
+        ch = channel_type::make(resource, segment_size, resource);
+    }
+    else ch = channel_type::make(resource);
+    return { static_sender<T, K>(ch), static_receiver<T, K>(ch) };
+}
+
+template<typename T, kind K>
+auto channel(std::ptrdiff_t capacity, const options& opts) -> std::pair<static_sender<T, K>, static_receiver<T, K>> {
+    static_assert(K == kind::bounded, "only kind::bounded takes a capacity");
+    if (capacity <= 0) throw invalid_capacity();
+    const auto resource = detail::resource_or_default(opts.resource);
+    auto* const ch = detail::static_channel<T, K>::make(resource, static_cast<std::size_t>(capacity), resource);
+    return { static_sender<T, K>(ch), static_receiver<T, K>(ch) };
+}
 
-    std::shared_ptr<detail::receiver<T>> _channel;
+}
+
+namespace jjc::spsc {
+
+using mpsc::blocking;
+using mpsc::invalid_capacity;
+using mpsc::options;
+using mpsc::recv_batch;
+using mpsc::recv_count;
+using mpsc::recv_result;
+using mpsc::send_count;
+using mpsc::send_result;
+using mpsc::status;
+using mpsc::unbounded;
+
+/**
+ * Has the same interface as jjc::mpsc::sender, but can only be moved.
+ */
+template<typename T>
+struct sender : private mpsc::sender<T> {
+    using mpsc::sender<T>::send;
+    using mpsc::sender<T>::try_send;
+    using mpsc::sender<T>::try_send_for;
+    using mpsc::sender<T>::try_send_until;
+    using mpsc::sender<T>::send_many;
+    using mpsc::sender<T>::try_send_many;
+    using mpsc::sender<T>::emplace;
+    using mpsc::sender<T>::blocks;
+
+    sender(sender&&) noexcept = default;
+    sender& operator=(sender&&) noexcept = default;
+    sender(const sender&) = delete;
+    sender& operator=(const sender&) = delete;
+
+private:
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+
+    explicit sender(std::shared_ptr<mpsc::detail::sender<T>> ch) :
+        mpsc::sender<T>(std::move(ch))
+    {}
 };
 
 template<typename T>
-auto channel(std::ptrdiff_t capacity) -> std::pair<sender<T>, receiver<T>> {
+auto channel(std::ptrdiff_t capacity, const options& opts) -> std::pair<sender<T>, receiver<T>> {
+    using mpsc::detail::allocate_channel;
+    const auto resource = mpsc::detail::resource_or_default(opts.resource);
     if (capacity == unbounded) {
-        auto chs = std::make_shared<detail::unbounded_channel<T>>();
+        const auto segment_size = opts.segment_size != 0 ? opts.segment_size : detail::default_segment_size;
+        auto chs = allocate_channel<detail::spsc_channel<T, detail::segments<T>>>(resource, segment_size, resource);
         auto chr = chs;
         return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
     }
     else if (capacity == 0) {
-        auto chs = std::make_shared<detail::rendezvous_channel<T>>();
+        auto chs = allocate_channel<mpsc::detail::rendezvous_channel<T>>(resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+    }
+    else if (capacity > 0) {
+        auto chs = allocate_channel<detail::spsc_channel<T, detail::ring<T>>>(resource, static_cast<std::size_t>(capacity), resource);
+        auto chr = chs;
+        return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
+    }
+    throw invalid_capacity();
+}
+
+}
+
+namespace jjc::mpmc {
+
+using mpsc::blocking;
+using mpsc::invalid_capacity;
+using mpsc::options;
+using mpsc::recv_batch;
+using mpsc::recv_count;
+using mpsc::recv_result;
+using mpsc::send_count;
+using mpsc::send_result;
+using mpsc::status;
+using mpsc::unbounded;
+
+/**
+ * Has the same interface as jjc::mpsc::receiver, but can also be copied.
+ */
+template<typename T>
+struct receiver : mpsc::receiver<T> {
+    receiver(receiver&&) noexcept = default;
+    receiver& operator=(receiver&&) noexcept = default;
+
+    receiver(const receiver& other) :
+        mpsc::receiver<T>(share(other))
+    {}
+
+    receiver& operator=(const receiver& rhs) {
+        if (this != &rhs) mpsc::receiver<T>::operator=(mpsc::receiver<T>(share(rhs)));
+        return *this;
+    }
+
+private:
+    friend auto channel<T>(std::ptrdiff_t, const options&) -> std::pair<sender<T>, receiver<T>>;
+
+    explicit receiver(std::shared_ptr<mpsc::detail::receiver<T>> ch) :
+        mpsc::receiver<T>(std::move(ch))
+    {}
+
+    static std::shared_ptr<mpsc::detail::receiver<T>> share(const receiver& r) {
+        const auto& ch = static_cast<const mpsc::receiver<T>&>(r)._channel;
+        ch->connect_receiver();
+        return ch;
+    }
+};
+
+template<typename T>
+auto channel(std::ptrdiff_t capacity, const options& opts) -> std::pair<sender<T>, receiver<T>> {
+    using mpsc::detail::allocate_channel;
+    const auto resource = mpsc::detail::resource_or_default(opts.resource);
+    if (capacity == unbounded) {
+        const auto segment_size = opts.segment_size != 0 ? opts.segment_size : detail::default_segment_size;
+        auto chs = allocate_channel<detail::segmented_channel<T>>(resource, segment_size, resource);
         auto chr = chs;
         return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
     }
     else if (capacity > 0) {
-        auto chs = std::make_shared<detail::bounded_channel<T>>(capacity);
+        using channel_type = mpsc::detail::bounded_channel<T, mpsc::detail::dynamic_capacity, true>;
+        auto chs = allocate_channel<channel_type>(resource, static_cast<std::size_t>(capacity), resource);
         auto chr = chs;
         return { sender<T>(std::move(chs)), receiver<T>(std::move(chr)) };
     }
@@ -225,4 +584,4 @@ auto channel(std::ptrdiff_t capacity) -> std::pair<sender<T>, receiver<T>> {
 
 }
 
-#endif//JJC_CONCURRENCY_CHANNEL_HPP
\ No newline at end of file
+#endif//JJC_CONCURRENCY_CHANNEL_HPP
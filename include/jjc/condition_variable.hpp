@@ -0,0 +1,110 @@
+#ifndef JJC_CONDITION_VARIABLE_HPP
+#define JJC_CONDITION_VARIABLE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <jjc/detail/wait.hpp>
+#include <jjc/mutex.hpp>
+#include <limits>
+#include <mutex>
+
+namespace jjc {
+
+// A condition variable for jjc::mutex.
+//
+// Waiters park on a sequence number that every notification bumps. notify_all
+// doesn't wake every waiter only for all but one of them to go straight back
+// to sleep on the mutex. It wakes one, and moves the rest onto the mutex's own
+// word, where unlocking the mutex wakes them one at a time. Each waiter
+// relocks the mutex as if it had been parked on it, so that unlocking it
+// always wakes the next one.
+class condition_variable {
+public:
+    constexpr condition_variable() noexcept = default;
+
+    condition_variable(const condition_variable&) = delete;
+
+    condition_variable& operator =(const condition_variable&) = delete;
+
+    void notify_one() noexcept {
+        _seq.fetch_add(1, std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_seq_cst) != 0) {
+            detail::concurrency::wake(&_seq, 1);
+        }
+    }
+
+    void notify_all() noexcept {
+        const auto seq = _seq.fetch_add(1, std::memory_order_seq_cst) + 1;
+        if (_waiters.load(std::memory_order_seq_cst) == 0) return;
+        // every waiter uses the same mutex, and stored it before counting
+        // itself in _waiters
+        auto* const m = _mutex.load(std::memory_order_relaxed);
+        detail::concurrency::requeue(&_seq, seq, &m->_sem._value, 1, std::numeric_limits<uint32_t>::max());
+    }
+
+    void wait(std::unique_lock<mutex>& lock) {
+        park(lock, static_cast<const std::chrono::steady_clock::time_point*>(nullptr));
+    }
+
+    template<typename Predicate>
+    void wait(std::unique_lock<mutex>& lock, Predicate pred) {
+        while (!pred()) wait(lock);
+    }
+
+    template<typename Rep, typename Period>
+    std::cv_status wait_for(std::unique_lock<mutex>& lock, const std::chrono::duration<Rep, Period>& d) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return wait_until(lock, t);
+    }
+
+    template<typename Rep, typename Period, typename Predicate>
+    bool wait_for(std::unique_lock<mutex>& lock, const std::chrono::duration<Rep, Period>& d, Predicate pred) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return wait_until(lock, t, std::move(pred));
+    }
+
+    template<typename Clock, typename Duration>
+    std::cv_status wait_until(std::unique_lock<mutex>& lock, const std::chrono::time_point<Clock, Duration>& t) {
+        park(lock, &t);
+        return Clock::now() >= t ? std::cv_status::timeout : std::cv_status::no_timeout;
+    }
+
+    template<typename Clock, typename Duration, typename Predicate>
+    bool wait_until(std::unique_lock<mutex>& lock, const std::chrono::time_point<Clock, Duration>& t, Predicate pred) {
+        while (!pred()) {
+            if (std::cv_status::timeout == wait_until(lock, t)) return pred();
+        }
+        return true;
+    }
+
+private:
+    template<typename Clock, typename Duration>
+    void park(std::unique_lock<mutex>& lock, const std::chrono::time_point<Clock, Duration>* t) {
+        assert(lock.owns_lock());
+        auto* const m = lock.mutex();
+        _mutex.store(m, std::memory_order_relaxed);
+        // Pairs with the notifier's bump of _seq: either the notifier sees
+        // this waiter, or this waiter sees the bumped value and doesn't sleep
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        const auto seq = _seq.load(std::memory_order_seq_cst);
+        lock.unlock();
+
+        if (t == nullptr) detail::concurrency::wait(&_seq, seq);
+        else detail::concurrency::wait_until(&_seq, seq, *t);
+
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
+        m->_sem.acquire_parked();
+        lock = std::unique_lock<mutex>(*m, std::adopt_lock);
+    }
+
+    std::atomic_uint32_t _seq = { 0 };
+    std::atomic_uint32_t _waiters = { 0 };
+    std::atomic<mutex*> _mutex = { nullptr };
+};
+
+}
+
+#endif//JJC_CONDITION_VARIABLE_HPP
@@ -0,0 +1,296 @@
+#ifndef JJC_DETAIL_BROADCAST_CHANNEL_HPP
+#define JJC_DETAIL_BROADCAST_CHANNEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/wait.hpp>
+#include <jjc/mutex.hpp>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace jjc::broadcast {
+
+enum class lag_policy {
+    // The sender waits for the slowest receiver
+    BLOCK,
+    // The sender overwrites items that a slow receiver hasn't seen yet, and
+    // that receiver's next receive reports how many it missed
+    SKIP
+};
+
+}
+
+namespace jjc::broadcast::detail {
+
+using mpsc::send_result;
+using mpsc::status;
+using mpsc::detail::cache_alignment;
+using mpsc::detail::object_array;
+using mpsc::detail::parking;
+
+template<typename T>
+struct slot {
+    // 2 * (pos + 1) once it holds the item at `pos`, and 2 * pos + 1 while
+    // that item is being written. 0 before the first item.
+    std::atomic_uint64_t seq = { 0 };
+    // The number of receivers copying the item out, plus `writer_waiting` if
+    // the sender is waiting for them before it replaces the item.
+    std::atomic_uint32_t pins = { 0 };
+    std::shared_ptr<const T> value = {};
+
+    static constexpr std::uint32_t writer_waiting = std::uint32_t(1) << 31;
+
+    void unpin() noexcept {
+        if (pins.fetch_sub(1, std::memory_order_release) == (writer_waiting | 1)) {
+            jjc::detail::concurrency::wake_all(&pins);
+        }
+    }
+};
+
+// A receiver's position in the ring
+struct cursor {
+    alignas(cache_alignment) std::atomic_uint64_t next = { 0 };
+};
+
+// One ring of items shared by every receiver, each with a cursor of its own.
+// An item is stored once, and receivers get shared read-only views of it, so
+// a receiver can hold on to an item for as long as it likes without holding
+// up the sender.
+//
+// Senders take turns through a mutex, so each position is written by one
+// sender at a time and published by advancing the tail. Under
+// lag_policy::BLOCK the sender waits until every cursor has passed the item
+// it is about to overwrite. It keeps the lowest cursor it has seen and only
+// rescans the cursors once that no longer lets it through.
+//
+// A receiver pins a slot only while it copies the view out. Before replacing
+// the item, the sender marks the slot busy and then waits for any pins to go,
+// while a receiver pins the slot and then re-checks that it is not busy. So
+// either the receiver backs off, or the sender waits for the copy to finish.
+// Receivers that fall behind under lag_policy::SKIP jump ahead to the oldest
+// item still in the ring.
+//
+// The ring and each item (with its shared_ptr control block) come from
+// `resource`, which must outlive the channel and every view of its items.
+template<typename T>
+struct channel {
+    channel(std::size_t capacity, lag_policy policy, std::pmr::memory_resource* resource) :
+        _resource(resource),
+        _slots(capacity, resource),
+        _size(capacity),
+        _pow2((capacity & (capacity - 1)) == 0),
+        _policy(policy)
+    {}
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    lag_policy policy() const noexcept { return _policy; }
+
+    // Registers a receiver whose next item is at `pos`
+    std::unique_ptr<cursor> subscribe(std::uint64_t pos) {
+        auto c = std::make_unique<cursor>();
+        c->next.store(pos, std::memory_order_relaxed);
+        const auto lk = std::scoped_lock(_registry.lock);
+        _registry.cursors.push_back(c.get());
+        return c;
+    }
+
+    void unsubscribe(cursor* c) {
+        {
+            const auto lk = std::scoped_lock(_registry.lock);
+            auto& cursors = _registry.cursors;
+            cursors.erase(std::find(cursors.begin(), cursors.end(), c));
+            if (cursors.empty()) _shared.open.store(false, std::memory_order_seq_cst);
+        }
+        // a sender may be waiting for this receiver, or for the last one
+        _send_wait.wake_all();
+    }
+
+    void connect() noexcept {
+        _producer.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void disconnect() {
+        if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
+            // Every send happens before this, so once a receiver sees the
+            // flag it has also seen every item.
+            _shared.disconnected.store(true, std::memory_order_seq_cst);
+            _recv_wait.wake_all();
+        }
+    }
+
+    // `tp` may be null to wait indefinitely. If `block` is false, the call
+    // fails rather than waiting for another sender or a slow receiver.
+    send_result<T> send(T&& v, bool block, const std::chrono::steady_clock::time_point* tp) {
+        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+
+        auto lk = std::unique_lock(_producer.lock, std::defer_lock);
+        if (!block) {
+            if (!lk.try_lock()) return { status::WOULD_BLOCK, std::move(v) };
+        }
+        else if (tp != nullptr) {
+            if (!lk.try_lock_until(*tp)) return { status::TIMEOUT, std::move(v) };
+        }
+        else lk.lock();
+
+        const auto pos = _producer.tail.load(std::memory_order_relaxed);
+        while (!has_room(pos)) {
+            if (!block) return { status::WOULD_BLOCK, std::move(v) };
+            if (!_send_wait.wait([this, pos] { return has_space(pos); }, tp)) return { status::TIMEOUT, std::move(v) };
+        }
+        // the last receiver may have gone while this waited
+        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+        write(pos, std::move(v));
+        return { status::OK, {} };
+    }
+
+    // The outcome of trying to take the item at a receiver's cursor
+    struct taken {
+        status result;
+        std::shared_ptr<const T> item = {};
+        std::uint64_t skipped = 0;
+    };
+
+    taken take(cursor& c) {
+        auto pos = c.next.load(std::memory_order_relaxed);
+        while (true) {
+            auto& s = at(pos);
+            const auto published = 2 * (pos + 1);
+            const auto seq = s.seq.load(std::memory_order_acquire);
+            if (seq == published) {
+                s.pins.fetch_add(1, std::memory_order_seq_cst);
+                if (s.seq.load(std::memory_order_seq_cst) == published) {
+                    auto item = s.value;
+                    s.unpin();
+                    advance(c, pos + 1);
+                    return { status::OK, std::move(item) };
+                }
+                // it is being overwritten
+                s.unpin();
+            }
+            else if (seq < published) {
+                if (!_shared.disconnected.load(std::memory_order_acquire)) return { status::WOULD_BLOCK };
+                // the final items may have been published after the first check
+                if (s.seq.load(std::memory_order_acquire) < published) return { status::CLOSED };
+                continue;
+            }
+
+            // Overwritten, so jump to the oldest item still in the ring. If
+            // that is overwritten before it is taken, the next take reports
+            // the receiver as lagging again.
+            const auto tail = _producer.tail.load(std::memory_order_acquire);
+            const auto oldest = tail - std::min<std::uint64_t>(tail, _size);
+            const auto skipped = std::max(oldest, pos + 1) - pos;
+            advance(c, pos + skipped);
+            return { status::LAGGED, nullptr, skipped };
+        }
+    }
+
+    // Returns false if tp passed before an item was published at the cursor
+    bool wait_for_item(const cursor& c, const std::chrono::steady_clock::time_point* tp) {
+        return _recv_wait.wait([this, &c] { return has_item(c); }, tp);
+    }
+
+private:
+    slot<T>& at(std::uint64_t pos) noexcept {
+        return _slots[_pow2 ? pos & (_size - 1) : pos % _size];
+    }
+
+    void advance(cursor& c, std::uint64_t pos) {
+        c.next.store(pos, std::memory_order_release);
+        if (lag_policy::BLOCK == _policy) _send_wait.notify_all();
+    }
+
+    // Whether every receiver is done with the item that `pos` will replace
+    bool has_room(std::uint64_t pos) {
+        if (lag_policy::SKIP == _policy || pos < _size) return true;
+        if (pos - _size < _producer.gate) return true;
+        _producer.gate = lowest_cursor(std::memory_order_acquire);
+        return pos - _size < _producer.gate;
+    }
+
+    bool has_space(std::uint64_t pos) {
+        return pos - _size < lowest_cursor(std::memory_order_seq_cst) || !_shared.open.load(std::memory_order_seq_cst);
+    }
+
+    std::uint64_t lowest_cursor(std::memory_order order) {
+        const auto lk = std::scoped_lock(_registry.lock);
+        auto lowest = _producer.tail.load(std::memory_order_relaxed);
+        for (const auto* c : _registry.cursors) lowest = std::min(lowest, c->next.load(order));
+        return lowest;
+    }
+
+    bool has_item(const cursor& c) noexcept {
+        const auto pos = c.next.load(std::memory_order_relaxed);
+        return at(pos).seq.load(std::memory_order_seq_cst) >= 2 * (pos + 1) ||
+            _shared.disconnected.load(std::memory_order_seq_cst);
+    }
+
+    // Waits until no receiver is copying the item in `s`
+    static void wait_unpinned(slot<T>& s) noexcept {
+        auto pins = s.pins.load(std::memory_order_seq_cst);
+        while ((pins & ~slot<T>::writer_waiting) != 0) {
+            const auto waiting = pins | slot<T>::writer_waiting;
+            if (pins == waiting || s.pins.compare_exchange_weak(pins, waiting, std::memory_order_seq_cst)) {
+                jjc::detail::concurrency::wait(&s.pins, waiting);
+                pins = s.pins.load(std::memory_order_seq_cst);
+            }
+        }
+        s.pins.fetch_and(~slot<T>::writer_waiting, std::memory_order_relaxed);
+    }
+
+    void write(std::uint64_t pos, T&& v) {
+        // allocate before the slot is marked busy, so nothing after can throw
+        auto item = std::shared_ptr<const T>(std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(_resource), std::move(v)));
+        auto& s = at(pos);
+        s.seq.store(2 * pos + 1, std::memory_order_seq_cst);
+        wait_unpinned(s);
+        // the replaced item is destroyed once the new one is published, if no
+        // receiver still holds it
+        item.swap(s.value);
+        s.seq.store(2 * (pos + 1), std::memory_order_release);
+        _producer.tail.store(pos + 1, std::memory_order_release);
+        _recv_wait.notify_all();
+    }
+
+    struct producer {
+        mutex lock = {};
+        std::atomic_uint64_t tail = { 0 };
+        // No receiver's cursor is below this
+        std::uint64_t gate = 0;
+        std::atomic_ptrdiff_t count = { 1 };
+    };
+
+    struct shared {
+        std::atomic_bool open = { true };
+        std::atomic_bool disconnected = { false };
+    };
+
+    struct registry {
+        mutex lock = {};
+        std::vector<cursor*> cursors = {};
+    };
+
+    std::pmr::memory_resource* const _resource;
+    object_array<slot<T>> _slots;
+    const std::size_t _size;
+    const bool _pow2;
+    const lag_policy _policy;
+    alignas(cache_alignment) producer _producer;
+    alignas(cache_alignment) shared _shared;
+    alignas(cache_alignment) registry _registry;
+    alignas(cache_alignment) parking _recv_wait;
+    alignas(cache_alignment) parking _send_wait;
+};
+
+}
+
+#endif//JJC_DETAIL_BROADCAST_CHANNEL_HPP
@@ -0,0 +1,320 @@
+#ifndef JJC_DETAIL_MPMC_UNBOUNDED_HPP
+#define JJC_DETAIL_MPMC_UNBOUNDED_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/segment_list.hpp>
+#include <jjc/detail/spin.hpp>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace jjc::mpmc::detail {
+
+using mpsc::blocking;
+using mpsc::recv_count;
+using mpsc::recv_result;
+using mpsc::send_count;
+using mpsc::send_result;
+using mpsc::status;
+using mpsc::detail::cache_alignment;
+using mpsc::detail::parking;
+using mpsc::detail::segment_list;
+using mpsc::detail::sink;
+using mpsc::detail::source;
+
+inline constexpr std::size_t default_segment_size = 64;
+
+// An unbounded multi-producer, multi-consumer channel over a segment_list.
+//
+// Consumers claim slots the same way producers do: a CAS advances a 64-bit
+// index whose low bits are the offset into the current segment and whose high
+// bits count segments. Whoever claims the last slot of a segment moves that
+// end on to the next one, and until it has, the offset reads as
+// `segment_size` and everyone else on that end backs off.
+//
+// A consumer only claims a slot once the tail shows some producer has
+// claimed it, then waits for it to be written. Segments are recycled by
+// consumers: the one that reads the last slot recycles the segment, unless
+// some other slot is still being read, in which case that slot is marked and
+// its reader finishes the job.
+// Segments come from `resource`, which must outlive the channel.
+//
+// A slot that is written without an item is skipped. That happens if
+// producing an item for send_many throws after its slot was claimed.
+template<typename T>
+struct segmented_channel : mpsc::detail::sender<T>, mpsc::detail::receiver<T> {
+    segmented_channel(std::size_t segment_size, std::pmr::memory_resource* resource) :
+        _consumer { segment::make(list::clamp(segment_size), resource) },
+        _producer { _consumer.first.load(std::memory_order_relaxed), list::clamp(segment_size), resource }
+    {}
+
+    ~segmented_channel() {
+        for (auto* s = _consumer.first.load(std::memory_order_relaxed); s != nullptr;) {
+            _producer.destroy(std::exchange(s, s->next.load(std::memory_order_relaxed)));
+        }
+    }
+
+    segmented_channel(const segmented_channel&) = delete;
+    segmented_channel& operator=(const segmented_channel&) = delete;
+
+    blocking send_blocks() final { return blocking::NEVER; }
+    blocking recv_blocks() final { return blocking::SOMETIMES; }
+
+    recv_result<T> receive() final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            wait_for_item(nullptr);
+            r = pop();
+        }
+        return r;
+    }
+
+    recv_result<T> try_receive() final {
+        return pop();
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!wait_for_item(&tp)) return { status::TIMEOUT };
+            r = pop();
+        }
+        return r;
+    }
+
+    parking* recv_parking() final { return &_recv_wait; }
+    bool recv_ready() final { return has_item(); }
+
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        std::size_t n = 0;
+        while (n < max_n) {
+            const auto s = take(out);
+            if (status::CLOSED == s) return { n, status::CLOSED };
+            if (status::OK != s) break;
+            ++n;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
+
+    send_result<T> send(T&& v) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+
+        const auto c = _producer.claim(1);
+        auto* const s = c.seg->slots() + c.offset;
+        {
+            // written empty if the move throws
+            publish_on_exit publish { *this, s, s + 1, 1 };
+            s->value.emplace(std::move(v));
+        }
+        return { status::OK, {} };
+    }
+
+    send_count send_many(std::size_t n, const source<T>& in) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+        for (std::size_t sent = 0; sent < n;) {
+            const auto c = _producer.claim(n - sent);
+            auto* const slots = c.seg->slots() + c.offset;
+            publish_on_exit publish { *this, slots, slots + c.count, c.count };
+            for (; publish.next != publish.last; ++publish.next) {
+                in(publish.next->value);
+                publish.next->state.fetch_or(written, std::memory_order_release);
+            }
+            sent += c.count;
+        }
+        return { n, status::OK };
+    }
+
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        return send_many(n, in);
+    }
+
+    void connect() final {
+        _producer.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void disconnect() final {
+        if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
+            // Every send happens before this, so once a consumer sees the
+            // flag it has also seen every item.
+            _shared.disconnected.store(true, std::memory_order_seq_cst);
+            _recv_wait.wake_all();
+        }
+    }
+
+    void connect_receiver() final {
+        _shared.receivers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void close() final {
+        if (1 == _shared.receivers.fetch_sub(1, std::memory_order_acq_rel)) {
+            _shared.open.store(false, std::memory_order_release);
+        }
+    }
+
+private:
+    // Slot states. A reader that finds `reclaim` set when it marks its slot
+    // read has to finish freeing the segment.
+    static constexpr std::uint32_t written = 1;
+    static constexpr std::uint32_t read = 2;
+    static constexpr std::uint32_t reclaim = 4;
+
+    using list = segment_list<T, std::uint32_t>;
+    using slot = typename list::slot;
+    using segment = typename list::segment;
+
+    static constexpr auto offset_mask = list::offset_mask;
+    static constexpr auto lap = list::lap;
+
+    // Claimed slots must always be written, even if producing an item throws,
+    // or a consumer would wait on them forever. Writes the slots from `next`
+    // on, and wakes consumers.
+    struct publish_on_exit {
+        segmented_channel& self;
+        slot* next;
+        slot* last;
+        const std::size_t count;
+
+        ~publish_on_exit() {
+            for (; next != last; ++next) next->state.fetch_or(written, std::memory_order_release);
+            if (count == 1) self._recv_wait.notify_one();
+            else self._recv_wait.notify_all();
+        }
+    };
+
+    // The position an index refers to. While an end moves on to the next
+    // segment, its index reads as one past the end of the current one.
+    std::uint64_t position(std::uint64_t index) const noexcept {
+        return (index & offset_mask) == _producer.size ? (index & ~offset_mask) + lap : index;
+    }
+
+    // Frees `s` once slots [start, size - 1) have all been read, or hands
+    // that duty to the reader of the first one that hasn't.
+    void release(segment* s, std::size_t start) noexcept {
+        auto* const slots = s->slots();
+        for (auto i = start; i + 1 < _producer.size; ++i) {
+            auto& sl = slots[i];
+            if ((sl.state.load(std::memory_order_acquire) & read) == 0 &&
+                (sl.state.fetch_or(reclaim, std::memory_order_acq_rel) & read) == 0) {
+                return;
+            }
+        }
+        _producer.recycle(s);
+    }
+
+    // Hands the next item to `out`, skipping any slot written empty
+    template<typename F>
+    status take(F&& out) {
+        const auto size = _producer.size;
+        auto b = jjc::detail::concurrency::backoff{};
+        // Every send happens before the last sender disconnects, so reading
+        // the flag first means an empty channel after it is closed for good.
+        auto closing = _shared.disconnected.load(std::memory_order_acquire);
+        auto index = _consumer.index.load(std::memory_order_acquire);
+        for (;;) {
+            const auto offset = static_cast<std::size_t>(index & offset_mask);
+            if (offset == size) {
+                // another consumer is moving on to the next segment
+                list::back_off(b);
+                index = _consumer.index.load(std::memory_order_acquire);
+                continue;
+            }
+
+            if (index == position(_producer.index.load(std::memory_order_acquire))) {
+                return closing ? status::CLOSED : status::WOULD_BLOCK;
+            }
+
+            // As for producers, the segment is published before the index
+            auto* const seg = _consumer.first.load(std::memory_order_acquire);
+            if (!_consumer.index.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                continue;
+            }
+
+            if (offset + 1 == size) {
+                // The producer that claimed this slot links in the next
+                // segment straight after.
+                auto* next = seg->next.load(std::memory_order_acquire);
+                for (auto wait = jjc::detail::concurrency::backoff{}; next == nullptr; next = seg->next.load(std::memory_order_acquire)) {
+                    list::back_off(wait);
+                }
+                _consumer.first.store(next, std::memory_order_release);
+                _consumer.index.store((index & ~offset_mask) + lap, std::memory_order_release);
+            }
+
+            auto& s = seg->slots()[offset];
+            for (auto wait = jjc::detail::concurrency::backoff{}; (s.state.load(std::memory_order_acquire) & written) == 0;) {
+                list::back_off(wait);
+            }
+            // The slot is this consumer's until it is marked read, so `out`
+            // gets the item where it is. The slot is freed even if it throws.
+            struct release_on_exit {
+                segmented_channel& self;
+                segment* seg;
+                std::size_t offset;
+                slot& s;
+
+                ~release_on_exit() {
+                    s.value.reset();
+                    if (offset + 1 == self._producer.size) self.release(seg, 0);
+                    else if (s.state.fetch_or(read, std::memory_order_acq_rel) & reclaim) self.release(seg, offset + 1);
+                }
+            };
+            {
+                const auto guard = release_on_exit { *this, seg, offset, s };
+                if (s.value) {
+                    out(std::move(*s.value));
+                    return status::OK;
+                }
+            }
+            closing = _shared.disconnected.load(std::memory_order_acquire);
+            index = _consumer.index.load(std::memory_order_acquire);
+        }
+    }
+
+    recv_result<T> pop() {
+        auto r = recv_result<T>(status::WOULD_BLOCK);
+        r.result = take([&r](T&& v) { r.emplace(std::move(v)); });
+        return r;
+    }
+
+    bool has_item() noexcept {
+        return position(_consumer.index.load(std::memory_order_seq_cst)) != position(_producer.index.load(std::memory_order_seq_cst)) ||
+            _shared.disconnected.load(std::memory_order_seq_cst);
+    }
+
+    // Returns false if tp passed before an item was published
+    bool wait_for_item(const std::chrono::steady_clock::time_point* tp) {
+        if (_consumer.spin.spin([this] { return has_item(); })) return true;
+        return _recv_wait.wait([this] { return has_item(); }, tp);
+    }
+
+    struct consumer {
+        std::atomic<segment*> first;
+        std::atomic<std::uint64_t> index = { 0 };
+        jjc::detail::concurrency::adaptive_spin spin = {};
+    };
+
+    struct shared {
+        std::atomic_bool open = { true };
+        std::atomic_bool disconnected = { false };
+        std::atomic_ptrdiff_t receivers = { 1 };
+    };
+
+    struct producer : list {
+        using list::list;
+        std::atomic_ptrdiff_t count = { 1 };
+    };
+
+    alignas(cache_alignment) consumer _consumer;
+    alignas(cache_alignment) shared _shared;
+    alignas(cache_alignment) producer _producer;
+    alignas(cache_alignment) parking _recv_wait;
+};
+
+}
+
+#endif//JJC_DETAIL_MPMC_UNBOUNDED_HPP
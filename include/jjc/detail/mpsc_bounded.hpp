@@ -1,47 +1,100 @@
 #ifndef JJC_CONCURRENCY_DETAIL_MPSC_BOUNDED_HPP
 #define JJC_CONCURRENCY_DETAIL_MPSC_BOUNDED_HPP
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <jjc/detail/mpsc_common.hpp>
-#include <jjc/event.hpp>
-#include <jjc/mutex.hpp>
-#include <jjc/semaphore.hpp>
-#include <mutex>
+#include <jjc/detail/spin.hpp>
+#include <memory_resource>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace jjc::mpsc::detail {
 
-// Very similar to the unbounded channel, but with a second FIFO of available
-// nodes.
-// Note that the total number of nodes is capacity + 2, and disconnecting all
-// receivers may add another node (disconnecting can never block).
+// Selects a ring whose capacity is only known at runtime
+inline constexpr std::size_t dynamic_capacity = 0;
+
 template<typename T>
-struct bounded_channel : detail::sender<T>, detail::receiver<T> {
-    bounded_channel(std::size_t capacity) :
-        _consumer(),
-        _shared(capacity),
-        _producer { _consumer.first }
+struct ring_slot {
+    // 2 * pos while free for the item at `pos`, 2 * pos + 1 once it holds it.
+    // Keeping the two states apart (rather than pos and pos + 1) lets a ring
+    // of one slot tell "full" from "free for the next lap".
+    std::atomic_size_t seq = { 0 };
+    std::optional<T> value = {};
+};
+
+// Slot storage for a ring of a fixed capacity. Positions map to slots with a
+// constant modulus, which is a mask for powers of two.
+template<typename Slot, std::size_t Capacity>
+struct ring_slots {
+    ring_slots(std::size_t, std::pmr::memory_resource*) noexcept {
+        for (std::size_t i = 0; i < Capacity; ++i) _slots[i].seq.store(2 * i, std::memory_order_relaxed);
+    }
+
+    static constexpr std::size_t size() noexcept { return Capacity; }
+
+    Slot& operator[](std::size_t pos) noexcept { return _slots[pos % Capacity]; }
+
+private:
+    std::array<Slot, Capacity> _slots;
+};
+
+template<typename Slot>
+struct ring_slots<Slot, dynamic_capacity> {
+    ring_slots(std::size_t capacity, std::pmr::memory_resource* resource) :
+        _slots(capacity, resource),
+        _size(capacity),
+        _pow2((capacity & (capacity - 1)) == 0)
     {
-        auto* p = new node();
-        _producer.available.store(p, std::memory_order_relaxed);
-        for (std::size_t i = 0; i < capacity; ++i) {
-            auto* n = new node();
-            p->next.store(n, std::memory_order_relaxed);
-            p = n;
-        }
-        _consumer.retired = p;
+        for (std::size_t i = 0; i < capacity; ++i) _slots[i].seq.store(2 * i, std::memory_order_relaxed);
     }
 
-    ~bounded_channel() {
-        while (_consumer.first != nullptr) {
-            delete std::exchange(_consumer.first, _consumer.first->next.load(std::memory_order_relaxed));
-        }
-        for (auto* n = _producer.available.load(std::memory_order_relaxed); n != nullptr;) {
-            delete std::exchange(n, n->next.load(std::memory_order_relaxed));
-        }
+    std::size_t size() const noexcept { return _size; }
+
+    Slot& operator[](std::size_t pos) noexcept {
+        return _slots[_pow2 ? pos & (_size - 1) : pos % _size];
     }
 
+private:
+    object_array<Slot> _slots;
+    std::size_t _size;
+    bool _pow2;
+};
+
+// A Vyukov-style ring of `capacity` slots, each carrying a sequence number
+// that says which lap of the ring it is ready for.
+//
+// Producers claim positions by advancing the tail with a CAS, but only once
+// the slot's sequence shows the consumer is done with it, so a full ring is
+// detected without any shared counter. send_many claims a run of slots with a
+// single CAS; since the consumer frees slots strictly in order, the run is
+// free as soon as its last slot is.
+//
+// Neither side touches a futex word unless the other is parked on it (see
+// detail::parking).
+//
+// With MultiConsumer, consumers claim positions from the head with a CAS in
+// the same way, and the channel is only closed once every receiver has. Slots
+// are then freed out of order, so a run is only claimed as far as every one
+// of its slots is free.
+//
+// A slot that is published without a value is skipped by the consumer. That
+// happens if producing an item for send_many throws after its slot was
+// claimed.
+template<typename T, std::size_t Capacity = dynamic_capacity, bool MultiConsumer = false>
+struct bounded_channel : detail::sender<T>, detail::receiver<T> {
+    explicit bounded_channel(
+        std::size_t capacity = Capacity,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    ) :
+        _ring(capacity, resource)
+    {}
+
     bounded_channel(const bounded_channel&) = delete;
     bounded_channel& operator =(const bounded_channel&) = delete;
 
@@ -49,45 +102,95 @@ struct bounded_channel : detail::sender<T>, detail::receiver<T> {
     blocking recv_blocks() final { return blocking::SOMETIMES; }
 
     recv_result<T> receive() final {
-        while (_consumer.first->next.load(std::memory_order_acquire) == nullptr) {
-            _shared.ready.wait();
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            wait_for_item(nullptr);
+            r = pop();
         }
-        return pop();
+        return r;
     }
 
     recv_result<T> try_receive() final {
-        if (_consumer.first->next.load(std::memory_order_acquire) != nullptr) {
-            return pop();
-        }
-        else return { status::WOULD_BLOCK };
+        return pop();
     }
 
     recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
-        while (_consumer.first->next.load(std::memory_order_acquire) == nullptr) {
-            if (!_shared.ready.wait_until(tp)) return { status::TIMEOUT };
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!wait_for_item(&tp)) return { status::TIMEOUT };
+            r = pop();
         }
-        return pop();
+        return r;
     }
 
-    send_result<T> send(T&& v) final {
-        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+    parking* recv_parking() final { return &_recv_wait; }
+    bool recv_ready() final { return has_item(); }
+
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        // Producers are notified once for everything freed
+        struct notify_on_exit {
+            bounded_channel& self;
+            std::size_t freed = 0;
+
+            ~notify_on_exit() {
+                if (freed != 0) self.notify_space(freed);
+            }
+        } notify { *this };
+
+        std::size_t n = 0;
+        while (n < max_n) {
+            const auto s = take(out, notify.freed);
+            if (status::CLOSED == s) return { n, status::CLOSED };
+            if (status::OK != s) break;
+            ++n;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
 
-        _shared.producer_sem.acquire();
-        return push(std::move(v));
+    send_result<T> send(T&& v) final {
+        return push(std::move(v), nullptr);
     }
 
     send_result<T> try_send(T&& v) final {
         if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
 
-        if (!_shared.producer_sem.try_acquire()) return { status::WOULD_BLOCK, std::move(v) };
-        return push(std::move(v));
+        const auto c = claim(1);
+        if (c.count == 0) return { status::WOULD_BLOCK, std::move(v) };
+        publish(c.pos, std::move(v));
+        return { status::OK, {} };
     }
 
     send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& tp) final {
-        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+        return push(std::move(v), &tp);
+    }
+
+    send_count send_many(std::size_t n, const source<T>& in) final {
+        std::size_t sent = 0;
+        while (sent < n) {
+            if (!_shared.open.load(std::memory_order_acquire)) return { sent, status::CLOSED };
 
-        if (!_shared.producer_sem.try_acquire_until(tp)) return { status::TIMEOUT, std::move(v) };
-        return push(std::move(v));
+            const auto c = claim(n - sent);
+            if (c.count == 0) {
+                wait_for_space(nullptr);
+                continue;
+            }
+            publish_many(c, in);
+            sent += c.count;
+        }
+        return { n, status::OK };
+    }
+
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+        std::size_t sent = 0;
+        while (sent < n) {
+            const auto c = claim(n - sent);
+            if (c.count == 0) break;
+            publish_many(c, in);
+            sent += c.count;
+        }
+        return { sent, sent == n ? status::OK : status::WOULD_BLOCK };
     }
 
     void connect() final {
@@ -96,94 +199,235 @@ struct bounded_channel : detail::sender<T>, detail::receiver<T> {
 
     void disconnect() final {
         if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
-            node* n = nullptr;
-            // re-use a node if available
-            if (_shared.producer_sem.try_acquire()) {
-                n = _producer.available.load(std::memory_order_relaxed);
-                _producer.available.store(n->next.load(std::memory_order_acquire), std::memory_order_relaxed);
-                recycle(n, {});
+            // Every send happens before this, so once the consumer sees the
+            // flag it has also seen every item. Disconnecting never blocks,
+            // even if the ring is full.
+            _shared.disconnected.store(true, std::memory_order_seq_cst);
+            _recv_wait.wake_all();
+        }
+    }
+
+    void connect_receiver() final {
+        _shared.receivers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void close() final {
+        if (1 != _shared.receivers.fetch_sub(1, std::memory_order_acq_rel)) return;
+        _shared.open.store(false, std::memory_order_seq_cst);
+        // Unblock producers waiting for space, they re-check `open`
+        _send_wait.wake_all();
+    }
+
+private:
+    using slot = ring_slot<T>;
+
+    struct claimed {
+        std::size_t pos;
+        std::size_t count;
+    };
+
+    static std::ptrdiff_t lag(std::size_t seq, std::size_t pos) noexcept {
+        return static_cast<std::ptrdiff_t>(seq - 2 * pos);
+    }
+
+    // Claims up to max_n consecutive free slots, or none if the ring is full
+    claimed claim(std::size_t max_n) {
+        auto contention = jjc::detail::concurrency::backoff{};
+        auto pos = _producer.tail.load(std::memory_order_relaxed);
+        while (true) {
+            const auto d = lag(_ring[pos].seq.load(std::memory_order_acquire), pos);
+            if (d < 0) return { pos, 0 };
+            if (d > 0) {
+                // another producer claimed it first
+                pos = _producer.tail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            auto count = std::min(max_n, _ring.size());
+            if constexpr (MultiConsumer) {
+                // consumers free slots out of order, so each one is checked
+                std::size_t free = 1;
+                while (free < count && lag(_ring[pos + free].seq.load(std::memory_order_acquire), pos + free) == 0) ++free;
+                count = free;
             }
-            // but don't block
             else {
-                n = new node();
+                while (count > 1 && lag(_ring[pos + count - 1].seq.load(std::memory_order_acquire), pos + count - 1) != 0) {
+                    count /= 2;
+                }
             }
-            _producer.last.load(std::memory_order_relaxed)->next.store(n, std::memory_order_release);
-            _shared.ready.signal();
+            if (_producer.tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                return { pos, count };
+            }
+            contention.pause();
         }
     }
 
-    void close() final {
-        _shared.open.store(false, std::memory_order_release);
-        // Unblock producers. It may be worth taking advantage of the specific
-        // semaphore implementation to just release(num_waiters).
-        auto* n = _consumer.first;
-        if (std::exchange(n, n->next.load(std::memory_order_acquire)) != nullptr) {
-            _shared.producer_sem.release(1);
+    // Claimed slots must always be published, even if producing an item
+    // throws, or the consumer would wait on them forever. Publishes the slots
+    // from `pos` on, and wakes consumers.
+    struct publish_on_exit {
+        bounded_channel& self;
+        std::size_t pos;
+        const std::size_t last;
+        const std::size_t count;
+
+        ~publish_on_exit() {
+            for (; pos != last; ++pos) self._ring[pos].seq.store(2 * pos + 1, std::memory_order_release);
+            self.notify_item(count);
         }
+    };
+
+    void publish(std::size_t pos, T&& v) {
+        // published empty if the move throws
+        publish_on_exit p { *this, pos, pos + 1, 1 };
+        _ring[pos].value.emplace(std::move(v));
     }
 
-private:
-    recv_result<T> pop() {
-        auto* const t = std::exchange(_consumer.first, _consumer.first->next.load(std::memory_order_relaxed));
-        t->next.store(nullptr, std::memory_order_relaxed);
-        _consumer.retired->next.store(t, std::memory_order_release);
-        _shared.producer_sem.release();
-        _consumer.retired = t;
-        if (auto& out = _consumer.first->value) {
-            return { std::move(*out) };
+    void publish_many(const claimed& c, const source<T>& in) {
+        publish_on_exit p { *this, c.pos, c.pos + c.count, c.count };
+        for (; p.pos != p.last; ++p.pos) {
+            auto& s = _ring[p.pos];
+            in(s.value);
+            s.seq.store(2 * p.pos + 1, std::memory_order_release);
         }
-        else return { status::CLOSED };
-    }
-
-    send_result<T> push(T&& v) {
-        auto* n = _producer.available.load(std::memory_order_relaxed);
-        for (
-            auto* next = n->next.load(std::memory_order_acquire);
-            !_producer.available.compare_exchange_strong(n, next, std::memory_order_acq_rel, std::memory_order_relaxed);
-            next = n->next.load(std::memory_order_acquire)
-        ) {}
-        recycle(n, std::move(v));
-        auto* last = _producer.last.load(std::memory_order_relaxed);
-        while(!_producer.last.compare_exchange_weak(last, n, std::memory_order_acq_rel, std::memory_order_relaxed)) {}
-        last->next.store(n, std::memory_order_release);
-        _shared.ready.signal();
-        return { status::OK, {} };
     }
 
-    struct node {
-        std::optional<T> value = {};
-        std::atomic<node*> next = { nullptr };
-    };
+    send_result<T> push(T&& v, const std::chrono::steady_clock::time_point* tp) {
+        while (true) {
+            if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
 
-    void recycle(node* n, std::optional<T>&& v) {
-        n->value = std::move(v);
-        n->next.store(nullptr, std::memory_order_relaxed);
+            const auto c = claim(1);
+            if (c.count != 0) {
+                publish(c.pos, std::move(v));
+                return { status::OK, {} };
+            }
+            if (!wait_for_space(tp)) {
+                // This may have been the producer woken for a slot it is
+                // now leaving behind, so pass the wake on
+                if (has_space()) _send_wait.notify_one();
+                return { status::TIMEOUT, std::move(v) };
+            }
+        }
+    }
+
+    // Hands the next item to `out`, skipping any slot published empty. The
+    // slot is freed even if `out` throws. `freed` counts the slots freed.
+    template<typename F>
+    status take(F&& out, std::size_t& freed) {
+        struct free_on_exit {
+            bounded_channel& self;
+            slot& s;
+            const std::size_t head;
+
+            ~free_on_exit() {
+                s.value.reset();
+                s.seq.store(2 * (head + self._ring.size()), std::memory_order_release);
+                if constexpr (!MultiConsumer) self._consumer.head = head + 1;
+            }
+        };
+
+        while (true) {
+            const auto head = consumer_head();
+            auto& s = _ring[head];
+            const auto d = lag(s.seq.load(std::memory_order_acquire), head) - 1;
+            if (d == 0) {
+                if (!claim_head(head)) continue;
+                ++freed;
+                free_on_exit guard { *this, s, head };
+                if (s.value) {
+                    out(std::move(*s.value));
+                    return status::OK;
+                }
+            }
+            // another consumer took it
+            else if (d > 0) continue;
+            else if (!_shared.disconnected.load(std::memory_order_acquire)) return status::WOULD_BLOCK;
+            // the final items may have been published after the first check
+            else if (lag(s.seq.load(std::memory_order_acquire), head) - 1 < 0) return status::CLOSED;
+        }
+    }
+
+    std::size_t consumer_head() const noexcept {
+        if constexpr (MultiConsumer) return _consumer.head.load(std::memory_order_relaxed);
+        else return _consumer.head;
+    }
+
+    bool claim_head(std::size_t head) noexcept {
+        if constexpr (MultiConsumer) return _consumer.head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed, std::memory_order_relaxed);
+        else return true;
+    }
+
+    recv_result<T> pop() {
+        std::size_t freed = 0;
+        auto r = recv_result<T>(status::WOULD_BLOCK);
+        const auto s = take([&r](T&& v) { r.emplace(std::move(v)); }, freed);
+        if (freed != 0) notify_space(freed);
+        r.result = s;
+        return r;
+    }
+
+    bool has_item() noexcept {
+        const auto head = consumer_head();
+        return _ring[head].seq.load(std::memory_order_seq_cst) == 2 * head + 1 ||
+            _shared.disconnected.load(std::memory_order_seq_cst);
+    }
+
+    bool has_space() noexcept {
+        const auto tail = _producer.tail.load(std::memory_order_relaxed);
+        return lag(_ring[tail].seq.load(std::memory_order_seq_cst), tail) >= 0 ||
+            !_shared.open.load(std::memory_order_seq_cst);
+    }
+
+    // Returns false if tp passed before an item was published
+    bool wait_for_item(const std::chrono::steady_clock::time_point* tp) {
+        if (_consumer.spin.spin([this] { return has_item(); })) return true;
+        return _recv_wait.wait([this] { return has_item(); }, tp);
+    }
+
+    // Returns false if tp passed before a slot was freed
+    bool wait_for_space(const std::chrono::steady_clock::time_point* tp) {
+        if (_producer.spin.spin([this] { return has_space(); })) return true;
+        return _send_wait.wait([this] { return has_space(); }, tp);
+    }
+
+    void notify_item(std::size_t count) {
+        // A batch can feed several consumers
+        if (MultiConsumer && count > 1) _recv_wait.notify_all();
+        else _recv_wait.notify_one();
+    }
+
+    void notify_space(std::size_t freed) {
+        // One producer per freed slot. A producer that times out instead of
+        // taking its slot wakes the next one.
+        if (freed > 1) _send_wait.notify_all();
+        else _send_wait.notify_one();
     }
 
     struct consumer {
-        node* first = new node();
-        node* retired = nullptr;
+        std::conditional_t<MultiConsumer, std::atomic_size_t, std::size_t> head = { 0 };
+        jjc::detail::concurrency::adaptive_spin spin = {};
     };
 
     struct shared {
-        counting_semaphore<> producer_sem;
-        event ready = {};
         std::atomic_bool open = { true };
-
-        shared(std::ptrdiff_t capacity) : producer_sem(capacity) {}
+        std::atomic_bool disconnected = { false };
+        std::atomic_ptrdiff_t receivers = { 1 };
     };
 
     struct producer {
-        std::atomic<node*> last;
-        std::atomic<node*> available = { nullptr };
+        std::atomic_size_t tail = { 0 };
         std::atomic_ptrdiff_t count = { 1 };
+        jjc::detail::concurrency::adaptive_spin spin = {};
     };
 
     alignas(detail::cache_alignment) consumer _consumer;
     alignas(detail::cache_alignment) shared _shared;
     alignas(detail::cache_alignment) producer _producer;
+    alignas(detail::cache_alignment) parking _recv_wait;
+    alignas(detail::cache_alignment) parking _send_wait;
+    alignas(detail::cache_alignment) ring_slots<slot, Capacity> _ring;
 };
 
 }
 
-#endif//JJC_CONCURRENCY_DETAIL_MPSC_BOUNDED_HPP
\ No newline at end of file
+#endif//JJC_CONCURRENCY_DETAIL_MPSC_BOUNDED_HPP
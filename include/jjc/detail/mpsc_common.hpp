@@ -1,14 +1,24 @@
 #ifndef JJC_DETAIL_MPSC_COMMON_HPP
 #define JJC_DETAIL_MPSC_COMMON_HPP
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/wait.hpp>
+#include <memory>
+#include <memory_resource>
 #include <new>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace jjc::mpsc {
 
 enum class status {
-    OK, WOULD_BLOCK, TIMEOUT, CLOSED
+    OK, WOULD_BLOCK, TIMEOUT, CLOSED,
+    // only from jjc::broadcast receivers that fell behind
+    LAGGED
 };
 
 template<typename T>
@@ -37,6 +47,30 @@ struct recv_result : std::optional<T> {
     recv_result(status s) : std::optional<T>(), result(s) {}
 };
 
+// The outcome of a batched send. The first `count` items were accepted, and
+// `result` is the reason the rest (if any) were not.
+struct send_count {
+    std::size_t count;
+    status result;
+
+    explicit operator bool() const { return result == status::OK; }
+};
+
+// The outcome of a batched receive that writes its items elsewhere. `result`
+// is CLOSED once the end of the channel has been reached, even if some items
+// were received before that.
+struct recv_count {
+    std::size_t count;
+    status result;
+
+    explicit operator bool() const { return result == status::OK; }
+};
+
+template<typename T>
+struct recv_batch : std::vector<T> {
+    status result = status::OK;
+};
+
 enum class blocking {
     NEVER, SOMETIMES, ALWAYS
 };
@@ -45,17 +79,224 @@ enum class blocking {
 
 namespace jjc::mpsc::detail {
 
+inline constexpr std::size_t default_pool_high_water = 1024;
+
 #if defined(__cpp_lib_hardware_interference_size)
 static constexpr auto cache_alignment = std::hardware_destructive_interference_size;
 #else
 static constexpr auto cache_alignment = 64;
 #endif
 
+// The resource a channel allocates from, see options::resource
+inline std::pmr::memory_resource* resource_or_default(std::pmr::memory_resource* r) noexcept {
+    return r != nullptr ? r : std::pmr::get_default_resource();
+}
+
+// Allocates a U from `r` and constructs it, like C++20's
+// polymorphic_allocator::new_object
+template<typename U, typename... Args>
+U* new_object(std::pmr::memory_resource* r, Args&&... args) {
+    void* const p = r->allocate(sizeof(U), alignof(U));
+    try {
+        return ::new (p) U(std::forward<Args>(args)...);
+    }
+    catch (...) {
+        r->deallocate(p, sizeof(U), alignof(U));
+        throw;
+    }
+}
+
+// Destroys and frees a U from new_object. Does nothing for null.
+template<typename U>
+void delete_object(std::pmr::memory_resource* r, U* p) noexcept {
+    if (p == nullptr) return;
+    p->~U();
+    r->deallocate(p, sizeof(U), alignof(U));
+}
+
+// Allocates a channel together with its shared_ptr control block from `r`
+template<typename C, typename... Args>
+std::shared_ptr<C> allocate_channel(std::pmr::memory_resource* r, Args&&... args) {
+    return std::allocate_shared<C>(std::pmr::polymorphic_allocator<C>(r), std::forward<Args>(args)...);
+}
+
+// A fixed number of default-constructed Us allocated from a memory resource
+template<typename U>
+struct object_array {
+    object_array(std::size_t n, std::pmr::memory_resource* r) :
+        _resource(r),
+        _data(static_cast<U*>(r->allocate(bytes(n), alignof(U)))),
+        _size(n)
+    {
+        std::size_t i = 0;
+        try {
+            for (; i < n; ++i) ::new (static_cast<void*>(_data + i)) U();
+        }
+        catch (...) {
+            while (i != 0) _data[--i].~U();
+            r->deallocate(_data, bytes(n), alignof(U));
+            throw;
+        }
+    }
+
+    ~object_array() {
+        for (std::size_t i = 0; i < _size; ++i) _data[i].~U();
+        _resource->deallocate(_data, bytes(_size), alignof(U));
+    }
+
+    object_array(const object_array&) = delete;
+    object_array& operator=(const object_array&) = delete;
+
+    U& operator[](std::size_t i) noexcept { return _data[i]; }
+
+private:
+    static std::size_t bytes(std::size_t n) {
+        if (n > std::size_t(-1) / sizeof(U)) throw std::bad_array_new_length();
+        return n * sizeof(U);
+    }
+
+    std::pmr::memory_resource* const _resource;
+    U* const _data;
+    const std::size_t _size;
+};
+
+// Where the system can't wait on several words at once, a select parks on this
+// one shared word instead. Every parking word bumps it when it wakes anyone
+// while such a select is registered.
+struct select_fallback {
+    inline static std::atomic_uint32_t epoch = { 0 };
+    inline static std::atomic_uint32_t waiters = { 0 };
+};
+
+// A futex word that one side of a channel parks on while it waits for the
+// other side. The notifier skips the wake entirely unless someone is parked:
+// a waiter registers before re-checking its condition, while the notifier
+// checks for waiters after a fence, so at least one of them sees the other.
+//
+// A select waits on several parking words at once, registering with each one
+// through enter() and leave() rather than wait(). It may return without taking
+// the item it was woken for, leaving another consumer of the same channel
+// asleep, so notify_one() wakes everyone while a select is registered.
+struct parking {
+    // Parks until notified, unless ready() holds once registered. ready()
+    // must use seq_cst loads. Returns false if `tp` (if any) passed first.
+    template<typename Ready>
+    bool wait(Ready&& ready, const std::chrono::steady_clock::time_point* tp) {
+        const auto e = enter();
+        auto result = true;
+        if (!ready()) {
+            if (tp == nullptr) {
+                jjc::detail::concurrency::wait(&_epoch, e);
+            }
+            else if (std::chrono::steady_clock::now() < *tp) {
+                jjc::detail::concurrency::wait_until(&_epoch, e, *tp);
+            }
+            else result = false;
+        }
+        leave();
+        return result;
+    }
+
+    // Registers as parked, and returns the value of word() to wait on. The
+    // caller must re-check its condition (with seq_cst loads) before waiting,
+    // and call leave() afterwards with the same `select`.
+    std::uint32_t enter(bool select = false) {
+        const auto e = _epoch.load(std::memory_order_acquire);
+        _parked.fetch_add(select ? selecting : 1, std::memory_order_seq_cst);
+        return e;
+    }
+
+    void leave(bool select = false) {
+        _parked.fetch_sub(select ? selecting : 1, std::memory_order_relaxed);
+    }
+
+    const std::atomic_uint32_t* word() const noexcept {
+        return &_epoch;
+    }
+
+    // Call after publishing whatever the waiters are waiting for
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto parked = _parked.load(std::memory_order_relaxed);
+        if (parked >= selecting) wake_all();
+        else if (parked != 0) wake(1);
+    }
+
+    void notify_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_parked.load(std::memory_order_relaxed) != 0) wake_all();
+    }
+
+    // Unconditionally wakes everyone, for rare state changes such as closing
+    void wake_all() {
+        _epoch.fetch_add(1, std::memory_order_release);
+        jjc::detail::concurrency::wake_all(&_epoch);
+        wake_selects();
+    }
+
+private:
+    void wake(std::uint32_t count) {
+        _epoch.fetch_add(1, std::memory_order_release);
+        jjc::detail::concurrency::wake(&_epoch, count);
+        wake_selects();
+    }
+
+    static void wake_selects() {
+        // A fallback select registers with select_fallback before it
+        // re-checks its receivers, so either it sees what this was woken for,
+        // or this sees it registered.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (select_fallback::waiters.load(std::memory_order_relaxed) == 0) return;
+        select_fallback::epoch.fetch_add(1, std::memory_order_release);
+        jjc::detail::concurrency::wake_all(&select_fallback::epoch);
+    }
+
+    // What a select adds to _parked, so one load tells the notifier about
+    // both kinds of waiter
+    static constexpr std::uint32_t selecting = std::uint32_t(1) << 16;
+
+    std::atomic_uint32_t _epoch = { 0 };
+    std::atomic_uint32_t _parked = { 0 };
+};
+
+// A non-owning, type-erased reference to a callable that constructs the next
+// T in the slot it is given. Batched sends use it to pull items only once
+// there is room for them, and to build each one where it is stored.
+template<typename T>
+struct source {
+    template<typename F>
+    explicit source(F& f) noexcept :
+        _fn([](void* ctx, std::optional<T>& slot) { (*static_cast<F*>(ctx))(slot); }),
+        _ctx(&f)
+    {}
+
+    void operator()(std::optional<T>& slot) const { _fn(_ctx, slot); }
+
+    // For channels that don't store items in an optional
+    T operator()() const {
+        auto v = std::optional<T>();
+        _fn(_ctx, v);
+        return std::move(*v);
+    }
+
+private:
+    void (*_fn)(void*, std::optional<T>&);
+    void* _ctx;
+};
+
 template<typename T>
 struct sender {
     virtual ~sender() = default;
     virtual void connect() = 0;
     virtual void disconnect() = 0;
+
+    // Called when a sender handle is copied, with the endpoint that handle
+    // refers to. Returns the endpoint the copy should use, which is the same
+    // one unless the channel gives each handle state of its own.
+    virtual std::shared_ptr<sender> fork(const std::shared_ptr<sender>& self) {
+        connect();
+        return self;
+    }
     virtual blocking send_blocks() = 0;
 
     virtual send_result<T> send(T&&) = 0;
@@ -68,6 +309,24 @@ struct sender {
         return send(std::move(v));
     }
 
+    // Sends the n items produced by `in`. Implementations should only pull an
+    // item from `in` once it is known that it will be accepted.
+    virtual send_count send_many(std::size_t n, const source<T>& in) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto r = send(in());
+            if (!r) return { i, r.result };
+        }
+        return { n, status::OK };
+    }
+
+    virtual send_count try_send_many(std::size_t n, const source<T>& in) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto r = try_send(in());
+            if (!r) return { i, r.result };
+        }
+        return { n, status::OK };
+    }
+
     // Remove any stored value from send_result, because:
     // a. users shouldn't care if they're already copying
     // b. the impl could defer the copy (don't allow users to rely on a value
@@ -86,20 +345,93 @@ struct sender {
     }
 
     send_result<T> try_send_until(const T& v, const std::chrono::steady_clock::time_point& tp) {
-        auto r = try_send_for(std::move(T(v)), tp);
+        auto r = try_send_until(std::move(T(v)), tp);
         r.item.reset();
         return r;
     }
 };
 
+// A non-owning, type-erased reference to a callable taking T&&. Batched
+// operations use it to hand out items without a virtual call per item.
 template<typename T>
-struct receiver {
+struct sink {
+    template<typename F>
+    explicit sink(F& f) noexcept :
+        _fn([](void* ctx, T&& v) { (*static_cast<F*>(ctx))(std::move(v)); }),
+        _ctx(&f)
+    {}
+
+    void operator()(T&& v) const { _fn(_ctx, std::move(v)); }
+
+private:
+    void (*_fn)(void*, T&&);
+    void* _ctx;
+};
+
+struct select_access;
+
+// What select needs from a receiver, whatever its item type
+struct selectable {
+    virtual ~selectable() = default;
+
+    // The word the receiver parks on while it waits for an item, or null if
+    // it can't be waited on that way, in which case select treats it as
+    // always ready.
+    virtual parking* recv_parking() { return nullptr; }
+
+    // Whether try_receive would return something other than WOULD_BLOCK. Uses
+    // seq_cst loads, as parking requires. Only the thread that owns the
+    // receiver may call it.
+    virtual bool recv_ready() { return true; }
+};
+
+template<typename T>
+struct receiver : selectable {
     virtual ~receiver() = default;
     virtual void close() = 0;
+
+    // Called when a receiver handle is copied, which only channels with
+    // multiple consumers allow. They close once every handle has.
+    virtual void connect_receiver() {}
+
     virtual blocking recv_blocks() = 0;
     virtual recv_result<T> receive() = 0;
     virtual recv_result<T> try_receive() = 0;
     virtual recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) = 0;
+
+    // Hands up to max_n items that are already available to `out` without
+    // blocking.
+    virtual recv_count drain(std::size_t max_n, const sink<T>& out) {
+        std::size_t n = 0;
+        while (n < max_n) {
+            auto r = try_receive();
+            if (!r) {
+                return { n, (n == 0 || r.result == status::CLOSED) ? r.result : status::OK };
+            }
+            out(std::move(*r));
+            ++n;
+        }
+        return { n, status::OK };
+    }
+
+    // Waits for an item and hands it to `out`. Channels that park on a word
+    // take it through drain, so `out` sees it where it is stored. The rest
+    // receive it first, as does a rendezvous, whose receiver has to wait
+    // within receive() for a sender to fill its slot.
+    status visit(const sink<T>& out) {
+        auto* const p = recv_parking();
+        if (p == nullptr || recv_blocks() == blocking::ALWAYS) {
+            auto r = receive();
+            if (r) out(std::move(*r));
+            return r.result;
+        }
+        for (;;) {
+            const auto r = drain(1, out);
+            if (r.count != 0) return status::OK;
+            if (status::CLOSED == r.result) return status::CLOSED;
+            p->wait([this] { return recv_ready(); }, nullptr);
+        }
+    }
 };
 
 }
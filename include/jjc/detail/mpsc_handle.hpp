@@ -0,0 +1,337 @@
+#ifndef JJC_DETAIL_MPSC_HANDLE_HPP
+#define JJC_DETAIL_MPSC_HANDLE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <jjc/detail/mpsc_common.hpp>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace jjc::mpsc::detail {
+
+// A concrete channel that belongs to the handles referring to it directly. All
+// senders together hold one reference to it and the receiver holds another,
+// so copying or dropping a sender only updates the sender count, unless it is
+// the last sender. The channel's own sender count is left at one until then.
+// The channel is allocated from, and returned to, the given memory resource.
+//
+// Being final lets every call through a counted<Impl>* be resolved at compile
+// time.
+template<typename Impl>
+struct counted final : Impl {
+    template<typename... Args>
+    explicit counted(std::pmr::memory_resource* resource, Args&&... args) :
+        Impl(std::forward<Args>(args)...),
+        _resource(resource)
+    {}
+
+    template<typename... Args>
+    static counted* make(std::pmr::memory_resource* resource, Args&&... args) {
+        return new_object<counted>(resource, resource, std::forward<Args>(args)...);
+    }
+
+    void add_sender() noexcept {
+        _senders.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void drop_sender() {
+        if (1 == _senders.fetch_sub(1, std::memory_order_acq_rel)) {
+            this->disconnect();
+            release();
+        }
+    }
+
+    void drop_receiver() {
+        this->close();
+        release();
+    }
+
+private:
+    void release() {
+        if (1 == _refs.fetch_sub(1, std::memory_order_acq_rel)) delete_object(_resource, this);
+    }
+
+    std::pmr::memory_resource* const _resource;
+    std::atomic_size_t _senders = { 1 };
+    std::atomic_uint32_t _refs = { 2 };
+};
+
+// The operations of a sender handle. `Ptr` points at the channel, either as a
+// shared_ptr to the type-erased interface (jjc::mpsc::sender) or as a plain
+// pointer to a concrete channel (jjc::mpsc::static_sender). Calls through the
+// latter are resolved at compile time and can be inlined. Owning the channel
+// is left to the handle.
+template<typename T, typename Ptr>
+struct sender_handle {
+    send_result<T> send(T&& v) {
+        return _channel->send(std::move(v));
+    }
+
+    // Copies straight into the channel's slot, see emplace
+    send_result<T> send(const T& v) {
+        return emplace(v);
+    }
+
+    send_result<T> try_send(T&& v) {
+        return _channel->try_send(std::move(v));
+    }
+
+    send_result<T> try_send(const T& v) {
+        return without_item(try_send(T(v)));
+    }
+
+    template<typename Rep, typename Period>
+    send_result<T> try_send_for(T&& v, const std::chrono::duration<Rep, Period>& timeout_after) {
+        const auto tp = std::chrono::steady_clock::now() + timeout_after;
+        return _channel->try_send_until(std::move(v), tp);
+    }
+
+    template<typename Rep, typename Period>
+    send_result<T> try_send_for(const T& v, const std::chrono::duration<Rep, Period>& timeout_after) {
+        const auto tp = std::chrono::steady_clock::now() + timeout_after;
+        return try_send_until(v, tp);
+    }
+
+    template<typename Clock, typename Duration>
+    send_result<T> try_send_until(T&& v, const std::chrono::time_point<Clock, Duration>& timeout_at) {
+        const auto d = timeout_at - Clock::now();
+        return try_send_for(std::move(v), d);
+    }
+
+    send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& timeout_at) {
+        return _channel->try_send_until(std::move(v), timeout_at);
+    }
+
+    template<typename Clock, typename Duration>
+    send_result<T> try_send_until(const T& v, const std::chrono::time_point<Clock, Duration>& timeout_at) {
+        const auto d = timeout_at - Clock::now();
+        return try_send_for(v, d);
+    }
+
+    send_result<T> try_send_until(const T& v, const std::chrono::steady_clock::time_point& timeout_at) {
+        return without_item(try_send_until(T(v), timeout_at));
+    }
+
+    /**
+     * Sends every item in [first, last), blocking whenever the channel is
+     * full. Items are constructed from `*it`, so use std::move_iterator to move
+     * them rather than copy.
+     * 
+     * Where possible the whole range (or as much of it as currently fits) is
+     * published at once, with a single update of the channel tail and a single
+     * notification of the receiver.
+     * 
+     * @returns the number of items sent, which is less than the size of the
+     *     range only if the channel was closed
+     */
+    template<typename ForwardIt>
+    send_count send_many(ForwardIt first, ForwardIt last) {
+        const auto n = static_cast<std::size_t>(std::distance(first, last));
+        auto next = [&first](std::optional<T>& slot) { slot.emplace(*first++); };
+        return _channel->send_many(n, detail::source<T>(next));
+    }
+
+    /**
+     * As send_many, but only sends as many items as fit without blocking.
+     * Items past the returned count are left untouched.
+     */
+    template<typename ForwardIt>
+    send_count try_send_many(ForwardIt first, ForwardIt last) {
+        const auto n = static_cast<std::size_t>(std::distance(first, last));
+        auto next = [&first](std::optional<T>& slot) { slot.emplace(*first++); };
+        return _channel->try_send_many(n, detail::source<T>(next));
+    }
+
+    /**
+     * Sends a T constructed from `args` directly where the channel stores it,
+     * so the item is never moved on the way in. Nothing is constructed if the
+     * channel is closed.
+     * 
+     * @returns as send, but never with the item
+     */
+    template<typename... Args>
+    send_result<T> emplace(Args&&... args) {
+        auto make = [&args...](std::optional<T>& slot) { slot.emplace(std::forward<Args>(args)...); };
+        const auto r = _channel->send_many(1, detail::source<T>(make));
+        return { r.result, {} };
+    }
+
+    blocking blocks() const noexcept {
+        return _channel->send_blocks();
+    }
+
+protected:
+    sender_handle() noexcept = default;
+
+    explicit sender_handle(Ptr ch) noexcept :
+        _channel(std::move(ch))
+    {}
+
+    Ptr _channel = {};
+
+private:
+    // Nothing is handed back from a send of a copy, as the caller still has
+    // the original (and an implementation may defer the copy).
+    static send_result<T> without_item(send_result<T>&& r) {
+        r.item.reset();
+        return std::move(r);
+    }
+};
+
+// As sender_handle, for receivers
+template<typename T, typename Ptr>
+struct receiver_handle {
+    recv_result<T> receive() {
+        return _channel->receive();
+    }
+
+    /**
+     * Blocks until an item is available, then calls `visit` with a T& to it
+     * where it is stored in the channel, so it needn't be moved out first. The
+     * item is consumed once `visit` returns or throws, and the reference must
+     * not be kept beyond that.
+     * 
+     * @returns OK, or CLOSED if the channel is closed and empty
+     */
+    template<typename F>
+    status receive(F&& visit) {
+        auto out = [&visit](T&& v) { visit(v); };
+        return _channel->visit(detail::sink<T>(out));
+    }
+
+    /**
+     * Blocks until an item is available and move-assigns it straight from the
+     * channel to `out`.
+     * 
+     * @returns OK, or CLOSED (leaving `out` untouched) if the channel is
+     *     closed and empty
+     */
+    status receive_into(T& out) {
+        return receive([&out](T& v) { out = std::move(v); });
+    }
+
+    recv_result<T> try_receive() {
+        return _channel->try_receive();
+    }
+
+    template<typename Rep, typename Period>
+    recv_result<T> try_receive_for(const std::chrono::duration<Rep, Period>& timeout_after) {
+        const auto tp = std::chrono::steady_clock::now() + timeout_after;
+        return _channel->try_receive_until(tp);
+    }
+
+    template<typename Clock, typename Duration>
+    recv_result<T> try_receive_until(const std::chrono::time_point<Clock, Duration>& timeout_at) {
+        const auto d = timeout_at - Clock::now();
+        return try_receive_for(d);
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& timeout_at) {
+        return _channel->try_receive_until(timeout_at);
+    }
+
+    /**
+     * Writes up to `max_n` items that are already in the channel to `out`
+     * without blocking.
+     * 
+     * @returns the number of items written, and WOULD_BLOCK if there were
+     *     none or CLOSED if the end of the channel was reached
+     */
+    template<typename OutputIt>
+    recv_count receive_many(OutputIt out, std::size_t max_n) {
+        auto put = [&out](T&& v) {
+            *out = std::move(v);
+            ++out;
+        };
+        return _channel->drain(max_n, detail::sink<T>(put));
+    }
+
+    /**
+     * Blocks until at least one item is available, then keeps collecting items
+     * until either `max_n` have been received or `linger` has passed since the
+     * first one arrived.
+     * 
+     * The result is CLOSED if the end of the channel was reached, in which case
+     * it still holds any items received before that.
+     */
+    template<typename Rep, typename Period>
+    recv_batch<T> receive_batch(std::size_t max_n, const std::chrono::duration<Rep, Period>& linger) {
+        auto batch = recv_batch<T>{};
+        if (max_n == 0) return batch;
+
+        auto first = _channel->receive();
+        if (!first) {
+            batch.result = first.result;
+            return batch;
+        }
+        batch.push_back(std::move(*first));
+
+        const auto deadline = std::chrono::steady_clock::now() + linger;
+        while (batch.size() < max_n) {
+            const auto drained = receive_many(std::back_inserter(batch), max_n - batch.size());
+            if (status::CLOSED == drained.result) {
+                batch.result = status::CLOSED;
+                break;
+            }
+            if (batch.size() == max_n) break;
+
+            auto next = _channel->try_receive_until(deadline);
+            if (!next) {
+                if (status::CLOSED == next.result) batch.result = status::CLOSED;
+                break;
+            }
+            batch.push_back(std::move(*next));
+        }
+        return batch;
+    }
+
+    blocking blocks() const noexcept {
+        return _channel->recv_blocks();
+    }
+
+    struct iterator {
+        T& operator *() { return *_result; }
+        iterator& operator++() { _result = _channel->receive(); return *this; }
+        bool operator!=(const iterator& rhs) { return _result.has_value() || rhs._result.has_value(); }
+
+    private:
+        using channel_type = typename std::pointer_traits<Ptr>::element_type;
+
+        friend iterator begin(receiver_handle& r);
+        friend constexpr iterator end(const receiver_handle&) noexcept;
+        constexpr iterator() noexcept = default;
+        constexpr iterator(channel_type* channel, recv_result<T> result) noexcept :
+            _channel(channel),
+            _result(std::move(result))
+        {}
+        channel_type* _channel = nullptr;
+        recv_result<T> _result = { status::CLOSED };
+    };
+
+private:
+    friend iterator begin(receiver_handle& r) {
+        auto item = r.receive();
+        return { &*r._channel, std::move(item) };
+    }
+
+    friend constexpr iterator end(const receiver_handle&) noexcept {
+        return {};
+    }
+
+protected:
+    receiver_handle() noexcept = default;
+
+    explicit receiver_handle(Ptr ch) noexcept :
+        _channel(std::move(ch))
+    {}
+
+    Ptr _channel = {};
+};
+
+}
+
+#endif//JJC_DETAIL_MPSC_HANDLE_HPP
@@ -0,0 +1,330 @@
+#ifndef JJC_DETAIL_MPSC_LANED_HPP
+#define JJC_DETAIL_MPSC_LANED_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/spin.hpp>
+#include <jjc/detail/spsc_channel.hpp>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace jjc::mpsc::detail {
+
+// An unbounded channel in which every sender handle has a lane of its own.
+//
+// A lane is a single-producer queue of segments, so sending never contends
+// with other senders: the producer writes its slot and publishes it with a
+// plain release store. Copying a handle creates a new lane (see fork), and
+// the receiver takes from the lanes in turn. Items from one sender are
+// received in the order they were sent, but there is no order between lanes.
+//
+// All lanes share one parking word for the receiver, so it still sleeps on a
+// single futex however many senders there are.
+//
+// The channel owns its lanes, and each sender handle keeps the whole channel
+// alive through an aliasing pointer to its lane. New lanes are pushed onto a
+// lock-free list that the receiver adopts from. The receiver frees a lane once
+// its sender has disconnected and everything in it has been received. Lanes
+// and their segments come from `resource`, which must outlive the channel.
+template<typename T>
+struct laned_channel : detail::receiver<T> {
+    struct lane;
+
+    laned_channel(std::size_t segment_size, std::pmr::memory_resource* resource) :
+        _resource(resource),
+        _segment_size(segment_size),
+        _consumer { std::pmr::vector<lane*>(resource) }
+    {
+        add_lane();
+    }
+
+    ~laned_channel() {
+        for (auto* l : _consumer.lanes) delete_object(_resource, l);
+        for (auto* l = _pending.load(std::memory_order_relaxed); l != nullptr;) delete_object(_resource, std::exchange(l, l->next_pending));
+    }
+
+    laned_channel(const laned_channel&) = delete;
+    laned_channel& operator=(const laned_channel&) = delete;
+
+    // The lane of the first sender, before the receiver has adopted it
+    lane* first_lane() noexcept {
+        return _pending.load(std::memory_order_relaxed);
+    }
+
+    blocking recv_blocks() final { return blocking::SOMETIMES; }
+
+    recv_result<T> receive() final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            wait_for_item(nullptr);
+            r = pop();
+        }
+        return r;
+    }
+
+    recv_result<T> try_receive() final {
+        return pop();
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!wait_for_item(&tp)) return { status::TIMEOUT };
+            r = pop();
+        }
+        return r;
+    }
+
+    parking* recv_parking() final { return &_recv_wait; }
+
+    // Adopting new lanes first, as an empty one would otherwise count
+    bool recv_ready() final {
+        adopt();
+        return has_item();
+    }
+
+    // Takes everything a lane has (up to max_n) before moving on to the next
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        const auto closing = _shared.disconnected.load(std::memory_order_acquire);
+        adopt();
+
+        std::size_t n = 0;
+        while (n < max_n) {
+            auto* l = next_ready();
+            if (l == nullptr) {
+                if (closing) return { n, status::CLOSED };
+                break;
+            }
+            for (auto k = std::min(max_n - n, l->available()); k != 0; --k) {
+                l->take(out);
+                ++n;
+            }
+            ++_consumer.cursor;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
+
+    void close() final {
+        _shared.open.store(false, std::memory_order_release);
+    }
+
+    struct lane final : detail::sender<T> {
+        lane(laned_channel& hub, std::size_t segment_size) :
+            _hub(hub),
+            _storage(segment_size, hub._resource)
+        {}
+
+        lane(const lane&) = delete;
+        lane& operator=(const lane&) = delete;
+
+        blocking send_blocks() final { return blocking::NEVER; }
+
+        send_result<T> send(T&& v) final {
+            if (!_hub._shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+
+            _storage.write_slot().emplace(std::move(v));
+            _storage.wrote();
+            _producer.tail.store(_producer.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            _hub._recv_wait.notify_one();
+            return { status::OK, {} };
+        }
+
+        // Publishes the whole batch with a single store. If producing an item
+        // throws, the ones before it are still sent.
+        send_count send_many(std::size_t n, const source<T>& in) final {
+            if (!_hub._shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+            struct publish_on_exit {
+                lane& self;
+                std::size_t filled = 0;
+
+                ~publish_on_exit() {
+                    if (filled == 0) return;
+                    auto& tail = self._producer.tail;
+                    tail.store(tail.load(std::memory_order_relaxed) + filled, std::memory_order_release);
+                    self._hub._recv_wait.notify_one();
+                }
+            } publish { *this };
+
+            for (; publish.filled < n; ++publish.filled) {
+                in(_storage.write_slot());
+                _storage.wrote();
+            }
+            return { n, status::OK };
+        }
+
+        send_count try_send_many(std::size_t n, const source<T>& in) final {
+            return send_many(n, in);
+        }
+
+        // Copies get a lane of their own, so this is never called
+        void connect() final {}
+
+        std::shared_ptr<detail::sender<T>> fork(const std::shared_ptr<detail::sender<T>>& self) final {
+            return std::shared_ptr<detail::sender<T>>(self, _hub.add_lane());
+        }
+
+        void disconnect() final {
+            auto& hub = _hub;
+            // Every send happens before this. Once the flag is set the
+            // receiver may free the lane, so nothing here touches it after.
+            _producer.disconnected.store(true, std::memory_order_release);
+            hub.release();
+        }
+
+    private:
+        friend laned_channel;
+
+        // The number of items the receiver can take without blocking
+        std::size_t available() noexcept {
+            if (_consumer.head == _consumer.tail_cache) {
+                _consumer.tail_cache = _producer.tail.load(std::memory_order_acquire);
+            }
+            return _consumer.tail_cache - _consumer.head;
+        }
+
+        // Whether the sender has gone and everything it sent was received
+        bool finished() noexcept {
+            return _producer.disconnected.load(std::memory_order_acquire) && available() == 0;
+        }
+
+        bool has_item() noexcept {
+            return _producer.tail.load(std::memory_order_seq_cst) != _consumer.head;
+        }
+
+        // Hands the next item to `out`. The slot is freed even if `out` throws.
+        template<typename F>
+        void take(F&& out) {
+            struct free_on_exit {
+                lane& self;
+                std::optional<T>& slot;
+
+                ~free_on_exit() {
+                    slot.reset();
+                    self._storage.read();
+                    ++self._consumer.head;
+                }
+            } guard { *this, _storage.read_slot() };
+            out(std::move(*guard.slot));
+        }
+
+        struct producer {
+            std::atomic_size_t tail = { 0 };
+            std::atomic_bool disconnected = { false };
+        };
+
+        struct consumer {
+            std::size_t head = 0;
+            std::size_t tail_cache = 0;
+        };
+
+        laned_channel& _hub;
+        lane* next_pending = nullptr;
+        alignas(cache_alignment) producer _producer;
+        alignas(cache_alignment) consumer _consumer;
+        spsc::detail::segments<T> _storage;
+    };
+
+private:
+    lane* add_lane() {
+        auto* l = new_object<lane>(_resource, *this, _segment_size);
+        _shared.producers.fetch_add(1, std::memory_order_relaxed);
+        l->next_pending = _pending.load(std::memory_order_relaxed);
+        while (!_pending.compare_exchange_weak(l->next_pending, l, std::memory_order_release, std::memory_order_relaxed)) {}
+        return l;
+    }
+
+    void release() {
+        if (1 == _shared.producers.fetch_sub(1, std::memory_order_acq_rel)) {
+            // Every lane's sends happen before this, so once the receiver sees
+            // the flag it has also seen every item.
+            _shared.disconnected.store(true, std::memory_order_seq_cst);
+            _recv_wait.wake_all();
+        }
+    }
+
+    // Starts polling any lanes created since the last call
+    void adopt() {
+        if (_pending.load(std::memory_order_relaxed) == nullptr) return;
+        for (auto* l = _pending.exchange(nullptr, std::memory_order_acquire); l != nullptr; l = l->next_pending) {
+            _consumer.lanes.push_back(l);
+        }
+    }
+
+    // The first lane from the cursor onwards with an item ready, freeing any
+    // finished lanes passed on the way. The cursor is left pointing at it.
+    lane* next_ready() {
+        auto& lanes = _consumer.lanes;
+        for (std::size_t seen = 0; seen < lanes.size();) {
+            if (_consumer.cursor >= lanes.size()) _consumer.cursor = 0;
+            auto* const l = lanes[_consumer.cursor];
+            if (l->available() != 0) return l;
+            if (l->finished()) {
+                delete_object(_resource, l);
+                lanes[_consumer.cursor] = lanes.back();
+                lanes.pop_back();
+                continue;
+            }
+            ++_consumer.cursor;
+            ++seen;
+        }
+        return nullptr;
+    }
+
+    recv_result<T> pop() {
+        // Every lane is created and written to before the last sender
+        // disconnects, so reading the flag first means a scan that finds
+        // nothing after it is conclusive.
+        const auto closing = _shared.disconnected.load(std::memory_order_acquire);
+        adopt();
+
+        auto* l = next_ready();
+        if (l == nullptr) return { closing ? status::CLOSED : status::WOULD_BLOCK };
+
+        auto r = recv_result<T>(status::OK);
+        l->take([&r](T&& v) { r.emplace(std::move(v)); });
+        ++_consumer.cursor;
+        return r;
+    }
+
+    bool has_item() noexcept {
+        if (_pending.load(std::memory_order_seq_cst) != nullptr) return true;
+        if (_shared.disconnected.load(std::memory_order_seq_cst)) return true;
+        return std::any_of(_consumer.lanes.begin(), _consumer.lanes.end(), [](lane* l) { return l->has_item(); });
+    }
+
+    // Returns false if tp passed before an item was published
+    bool wait_for_item(const std::chrono::steady_clock::time_point* tp) {
+        if (_consumer.spin.spin([this] { return has_item(); })) return true;
+        return _recv_wait.wait([this] { return has_item(); }, tp);
+    }
+
+    struct consumer {
+        std::pmr::vector<lane*> lanes;
+        std::size_t cursor = 0;
+        jjc::detail::concurrency::adaptive_spin spin = {};
+    };
+
+    struct shared {
+        std::atomic_bool open = { true };
+        std::atomic_bool disconnected = { false };
+        std::atomic_ptrdiff_t producers = { 0 };
+    };
+
+    std::pmr::memory_resource* const _resource;
+    const std::size_t _segment_size;
+    alignas(cache_alignment) consumer _consumer;
+    alignas(cache_alignment) shared _shared;
+    alignas(cache_alignment) std::atomic<lane*> _pending = { nullptr };
+    alignas(cache_alignment) parking _recv_wait;
+};
+
+}
+
+#endif//JJC_DETAIL_MPSC_LANED_HPP
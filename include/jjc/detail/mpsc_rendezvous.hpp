@@ -3,101 +3,105 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <jjc/detail/mpsc_common.hpp>
-#include <jjc/event.hpp>
+#include <jjc/detail/wait.hpp>
 #include <jjc/mutex.hpp>
 #include <mutex>
 #include <optional>
+#include <utility>
 
 namespace jjc::mpsc::detail {
 
-// Basic algo:
-// * mutex starts locked
-// * a single sender acquires the mutex, emplaces the item
-// * receiver unlocks mutex, waits on a flag that item is available, locks the
-//   mutex and take the item
-// * disconnecting sets the flag without placing an item
-// * an additional mutex ensures that only one sender can ever be attempting the
-//   rendezvous at a time
+// Items are handed over directly, through a single word that both sides park
+// on. Whichever side arrives first publishes where the exchange happens:
+// * a waiting receiver publishes its slot (RECV_WAITING), and a sender claims
+//   it (FILLING), moves its item in and returns to IDLE
+// * a waiting sender publishes its item (OFFERED), and the receiver claims it
+//   (TAKING), moves it out and returns to IDLE
+// Either way the side that arrived second completes the exchange and wakes
+// the other, so each item costs at most one wake. A waiting side withdraws on
+// timeout by moving the phase back to IDLE. If that fails, the other side has
+// already claimed the exchange, which then completes.
+//
+// Only the receiver and one sender at a time take part, so senders take turns
+// through a mutex, which costs nothing while there is only one of them.
+// Closing either end sets a flag in the same word, so a parked side can't
+// miss it.
+//
+// A select can't publish a slot, as it doesn't take the item, so it waits for
+// an offer instead, on a separate parking word that a sender notifies once it
+// has offered its item.
 template<typename T>
 struct rendezvous_channel : detail::sender<T>, detail::receiver<T> {
-    rendezvous_channel() {
-        _shared.item_lock.lock();
-    }
+    rendezvous_channel() = default;
+
+    rendezvous_channel(const rendezvous_channel&) = delete;
+    rendezvous_channel& operator=(const rendezvous_channel&) = delete;
 
     blocking send_blocks() final { return blocking::ALWAYS; }
     blocking recv_blocks() final { return blocking::ALWAYS; }
 
     recv_result<T> receive() final {
-        _shared.item_lock.unlock();
-        _shared.item_ready.wait();
-        _shared.item_lock.lock();
-        _shared.can_leave.signal();
-        auto item = std::exchange(_shared.item, {});
-        if (item) {
-            return { std::move(*item) };
-        }
-        else {
-            // unlock to make more generic over the mutex type
-            _shared.item_lock.unlock();
-            return { status::CLOSED };
-        }
+        return take(true, nullptr);
     }
 
+    // Succeeds if a sender is already waiting
     recv_result<T> try_receive() final {
-        return { status::WOULD_BLOCK };
+        return take(false, nullptr);
     }
 
     recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
-        _shared.item_lock.unlock();
-        const auto signaled = _shared.item_ready.wait_until(tp);
-        _shared.item_lock.lock();
-        _shared.can_leave.signal();
-        if (!signaled) return { status::TIMEOUT };
-        auto item = std::exchange(_shared.item, {});
-        if (item) {
-            return { std::move(*item) };
-        }
-        else {
-            _shared.item_lock.unlock();
-            return { status::CLOSED };
-        }
+        return take(true, &tp);
     }
 
-    send_result<T> send(T&& v) final {
-        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+    parking* recv_parking() final { return &_recv_wait; }
 
-        const auto lk1 = std::scoped_lock(_producer.throttle);
-        {
-            const auto lk2 = std::scoped_lock(_shared.item_lock);
-            _shared.item = std::move(v);
-        }
-        _shared.item_ready.signal();
-        _shared.can_leave.wait();
-        return { status::OK, {} };
+    // Ready while a sender is waiting with its item, or once every sender is
+    // gone
+    bool recv_ready() final {
+        const auto s = _shared.state.load(std::memory_order_seq_cst);
+        return phase(s) == offered || (s & senders_gone) != 0;
+    }
+
+    send_result<T> send(T&& v) final {
+        if (closed()) return { status::CLOSED, std::move(v) };
+        const auto lk = std::scoped_lock(_producer.turn);
+        return give(std::move(v), true, nullptr);
     }
 
+    // Succeeds if the receiver is already waiting
     send_result<T> try_send(T&& v) final {
-        // It's of questionable utility to check to see if the channel is open
-        // first when the call will always fail, but it does make behavior more
-        // predictable.
-        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
-        return { status::WOULD_BLOCK, std::move(v) };
+        if (closed()) return { status::CLOSED, std::move(v) };
+        auto lk = std::unique_lock(_producer.turn, std::try_to_lock);
+        if (!lk) return { status::WOULD_BLOCK, std::move(v) };
+        return give(std::move(v), false, nullptr);
     }
 
     send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& tp) final {
-        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
-
-        if (!_producer.throttle.try_lock_until(tp)) return { status::TIMEOUT, std::move(v) };
-        const auto lk1 = std::scoped_lock(std::adopt_lock, _producer.throttle);
-        {
-            if (!_shared.item_lock.try_lock_until(tp)) return { status::TIMEOUT, std::move(v) };
-            const auto lk2 = std::scoped_lock(std::adopt_lock, _shared.item_lock);
-            _shared.item = std::move(v);
+        if (closed()) return { status::CLOSED, std::move(v) };
+        auto lk = std::unique_lock(_producer.turn, std::defer_lock);
+        if (!lk.try_lock_until(tp)) return { status::TIMEOUT, std::move(v) };
+        return give(std::move(v), true, &tp);
+    }
+
+    // Only pulls an item from `in` once the receiver's slot is claimed, and
+    // then produces it straight into the slot
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        if (closed()) return { 0, status::CLOSED };
+        auto lk = std::unique_lock(_producer.turn, std::try_to_lock);
+        if (!lk) return { 0, n == 0 ? status::OK : status::WOULD_BLOCK };
+
+        std::size_t i = 0;
+        auto s = _shared.state.load(std::memory_order_acquire);
+        while (i < n && phase(s) == recv_waiting) {
+            if (fill(s, in)) {
+                ++i;
+                s = _shared.state.load(std::memory_order_acquire);
+            }
         }
-        _shared.item_ready.signal();
-        _shared.can_leave.wait();
-        return { status::OK, {} };
+        if (i == n) return { n, status::OK };
+        return { i, (s & receiver_gone) ? status::CLOSED : status::WOULD_BLOCK };
     }
 
     void connect() final {
@@ -106,32 +110,159 @@ struct rendezvous_channel : detail::sender<T>, detail::receiver<T> {
 
     void disconnect() final {
         if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
-            _shared.item_ready.signal();
+            // Every send has finished by now, so nothing is left to receive
+            _shared.state.fetch_or(senders_gone, std::memory_order_release);
+            jjc::detail::concurrency::wake_all(&_shared.state);
+            _recv_wait.wake_all();
         }
     }
 
     void close() final {
-        _shared.open.store(false, std::memory_order_release);
+        _shared.state.fetch_or(receiver_gone, std::memory_order_release);
+        jjc::detail::concurrency::wake_all(&_shared.state);
     }
 
 private:
+    // The phase is in the low bits of the state, and every transition adds or
+    // subtracts the difference, which leaves the flags as they are.
+    static constexpr std::uint32_t idle = 0;
+    static constexpr std::uint32_t recv_waiting = 1;
+    static constexpr std::uint32_t filling = 2;
+    static constexpr std::uint32_t offered = 3;
+    static constexpr std::uint32_t taking = 4;
+    static constexpr std::uint32_t phase_mask = 7;
+    static constexpr std::uint32_t senders_gone = 8;
+    static constexpr std::uint32_t receiver_gone = 16;
+
+    static std::uint32_t phase(std::uint32_t s) noexcept { return s & phase_mask; }
+
+    bool closed() const noexcept {
+        return (_shared.state.load(std::memory_order_acquire) & receiver_gone) != 0;
+    }
+
+    static bool expired(const std::chrono::steady_clock::time_point* tp) noexcept {
+        return tp != nullptr && std::chrono::steady_clock::now() >= *tp;
+    }
+
+    void park(std::uint32_t s, const std::chrono::steady_clock::time_point* tp) noexcept {
+        if (tp == nullptr) jjc::detail::concurrency::wait(&_shared.state, s);
+        else jjc::detail::concurrency::wait_until(&_shared.state, s, *tp);
+    }
+
+    // Claims the receiver's slot if it is still waiting in state `s`, which is
+    // reloaded on failure. If `write` throws, the receiver keeps waiting.
+    template<typename F>
+    bool fill(std::uint32_t& s, F&& write) {
+        auto& state = _shared.state;
+        if (!state.compare_exchange_weak(s, s + (filling - recv_waiting), std::memory_order_acquire)) return false;
+        try {
+            write(_shared.slot);
+        }
+        catch (...) {
+            state.fetch_sub(filling - recv_waiting, std::memory_order_relaxed);
+            throw;
+        }
+        state.fetch_sub(filling, std::memory_order_release);
+        jjc::detail::concurrency::wake(&state, 1);
+        return true;
+    }
+
+    // Called with the sender's turn held, so the phase is either IDLE or
+    // RECV_WAITING to begin with
+    send_result<T> give(T&& v, bool block, const std::chrono::steady_clock::time_point* tp) {
+        auto& state = _shared.state;
+        auto s = state.load(std::memory_order_acquire);
+        for (;;) {
+            if (s & receiver_gone) return { status::CLOSED, std::move(v) };
+
+            if (phase(s) == recv_waiting) {
+                if (fill(s, [&v](std::optional<T>& slot) { slot.emplace(std::move(v)); })) return { status::OK, {} };
+                continue;
+            }
+
+            if (!block) return { status::WOULD_BLOCK, std::move(v) };
+            if (expired(tp)) return { status::TIMEOUT, std::move(v) };
+            _shared.offer = &v;
+            if (state.compare_exchange_weak(s, s + offered, std::memory_order_release, std::memory_order_acquire)) break;
+        }
+        _recv_wait.notify_one();
+
+        // Offered, so wait for the receiver to take it or withdraw
+        for (;;) {
+            s = state.load(std::memory_order_acquire);
+            if (phase(s) != offered && phase(s) != taking) return { status::OK, {} };
+            if (phase(s) == offered && ((s & receiver_gone) || expired(tp))) {
+                if (state.compare_exchange_strong(s, s - offered, std::memory_order_relaxed)) {
+                    return { (s & receiver_gone) ? status::CLOSED : status::TIMEOUT, std::move(v) };
+                }
+                continue;
+            }
+            park(s, tp);
+        }
+    }
+
+    recv_result<T> take(bool block, const std::chrono::steady_clock::time_point* tp) {
+        auto& state = _shared.state;
+        auto s = state.load(std::memory_order_acquire);
+        for (;;) {
+            if (phase(s) == offered) {
+                if (!state.compare_exchange_weak(s, s + (taking - offered), std::memory_order_acquire)) continue;
+                auto r = [&] {
+                    try {
+                        return recv_result<T>(std::move(*_shared.offer));
+                    }
+                    catch (...) {
+                        state.fetch_sub(taking - offered, std::memory_order_relaxed);
+                        throw;
+                    }
+                }();
+                state.fetch_sub(taking, std::memory_order_release);
+                jjc::detail::concurrency::wake(&state, 1);
+                return r;
+            }
+
+            if (s & senders_gone) return { status::CLOSED };
+            if (!block) return { status::WOULD_BLOCK };
+            if (expired(tp)) return { status::TIMEOUT };
+            if (state.compare_exchange_weak(s, s + recv_waiting, std::memory_order_release, std::memory_order_acquire)) break;
+        }
+
+        // Waiting, so wait for a sender to fill the slot, or withdraw
+        for (;;) {
+            s = state.load(std::memory_order_acquire);
+            if (phase(s) != recv_waiting && phase(s) != filling) {
+                auto r = recv_result<T>(std::move(*_shared.slot));
+                _shared.slot.reset();
+                return r;
+            }
+            if (phase(s) == recv_waiting && ((s & senders_gone) || expired(tp))) {
+                if (state.compare_exchange_strong(s, s - recv_waiting, std::memory_order_relaxed)) {
+                    return { (s & senders_gone) ? status::CLOSED : status::TIMEOUT };
+                }
+                continue;
+            }
+            park(s, tp);
+        }
+    }
+
     struct producer {
-        mutex throttle = {};
+        mutex turn = {};
         std::atomic_ptrdiff_t count = { 1 };
     };
 
     struct shared {
-        std::atomic_bool open = { true };
-        mutex item_lock = {};
-        event item_ready = {};
-        std::optional<T> item = {};
-        event can_leave = {}; // need to re-think, don't really want this here
+        std::atomic_uint32_t state = { idle };
+        // the waiting sender's item, while OFFERED
+        T* offer = nullptr;
+        // the waiting receiver's slot, filled while FILLING
+        std::optional<T> slot = {};
     };
 
     alignas(detail::cache_alignment) producer _producer = {};
     alignas(detail::cache_alignment) shared _shared = {};
+    alignas(detail::cache_alignment) parking _recv_wait;
 };
 
 }
 
-#endif//JJC_DETAIL_MPSC_RENDEZVOUZ_HPP
\ No newline at end of file
+#endif//JJC_DETAIL_MPSC_RENDEZVOUZ_HPP
@@ -0,0 +1,223 @@
+#ifndef JJC_DETAIL_MPSC_SEGMENTED_HPP
+#define JJC_DETAIL_MPSC_SEGMENTED_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/segment_list.hpp>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace jjc::mpsc::detail {
+
+// An unbounded channel over a segment_list, which has the details of how
+// producers claim slots.
+//
+// A slot's state is whether it is ready. A slot is only ever accessed by the
+// producer that claimed it and then by the consumer, so the consumer can
+// recycle a segment as soon as it has read its last slot.
+// Segments come from `resource`, which must outlive the channel.
+//
+// A slot that is marked ready but holds no item is skipped. That happens if
+// producing an item for send_many throws after its slot was claimed.
+template<typename T>
+struct segmented_channel : detail::sender<T>, detail::receiver<T> {
+    segmented_channel(std::size_t segment_size, std::pmr::memory_resource* resource) :
+        _consumer { segment::make(list::clamp(segment_size), resource) },
+        _producer { _consumer.first, list::clamp(segment_size), resource }
+    {}
+
+    ~segmented_channel() {
+        for (auto* s = _consumer.first; s != nullptr;) {
+            _producer.destroy(std::exchange(s, s->next.load(std::memory_order_relaxed)));
+        }
+    }
+
+    segmented_channel(const segmented_channel&) = delete;
+    segmented_channel& operator=(const segmented_channel&) = delete;
+
+    blocking send_blocks() final { return blocking::NEVER; }
+    blocking recv_blocks() final { return blocking::SOMETIMES; }
+
+    recv_result<T> receive() final {
+        auto r = try_receive();
+        while (status::WOULD_BLOCK == r.result) {
+            _recv_wait.wait([this] { return recv_ready(); }, nullptr);
+            r = try_receive();
+        }
+        return r;
+    }
+
+    recv_result<T> try_receive() final {
+        return pop();
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
+        auto r = try_receive();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!_recv_wait.wait([this] { return recv_ready(); }, &tp)) return { status::TIMEOUT };
+            r = try_receive();
+        }
+        return r;
+    }
+
+    parking* recv_parking() final { return &_recv_wait; }
+
+    bool recv_ready() final {
+        return _consumer.first->slots()[_consumer.offset].state.load(std::memory_order_seq_cst) ||
+            _shared.disconnected.load(std::memory_order_seq_cst);
+    }
+
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        std::size_t n = 0;
+        while (n < max_n) {
+            const auto s = take(out);
+            if (status::CLOSED == s) return { n, status::CLOSED };
+            if (status::OK != s) break;
+            ++n;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
+
+    send_result<T> send(T&& v) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+
+        const auto c = _producer.claim(1);
+        auto* const s = c.seg->slots() + c.offset;
+        {
+            // published empty if the move throws
+            publish_on_exit publish { *this, s, s + 1 };
+            s->value.emplace(std::move(v));
+        }
+        return { status::OK, {} };
+    }
+
+    send_count send_many(std::size_t n, const source<T>& in) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+        // Slots are claimed as many at a time as the tail segment has room
+        // for.
+        for (std::size_t sent = 0; sent < n;) {
+            const auto c = _producer.claim(n - sent);
+            auto* const slots = c.seg->slots() + c.offset;
+            publish_on_exit publish { *this, slots, slots + c.count };
+            for (; publish.next != publish.last; ++publish.next) {
+                in(publish.next->value);
+                publish.next->state.store(true, std::memory_order_release);
+            }
+            sent += c.count;
+        }
+        return { n, status::OK };
+    }
+
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        return send_many(n, in);
+    }
+
+    void connect() final {
+        _producer.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void disconnect() final {
+        if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
+            // Every send happens before this, so once the consumer sees the
+            // flag it has also seen every item.
+            _shared.disconnected.store(true, std::memory_order_release);
+            _recv_wait.notify_one();
+        }
+    }
+
+    void close() final {
+        _shared.open.store(false, std::memory_order_release);
+    }
+
+private:
+    using list = segment_list<T, bool>;
+    using slot = typename list::slot;
+    using segment = typename list::segment;
+
+    // Claimed slots must always be published, even if producing an item
+    // throws, or the consumer would wait on them forever. Publishes the slots
+    // from `next` on, and wakes the consumer.
+    struct publish_on_exit {
+        segmented_channel& self;
+        slot* next;
+        slot* last;
+
+        ~publish_on_exit() {
+            for (; next != last; ++next) next->state.store(true, std::memory_order_release);
+            self._recv_wait.notify_one();
+        }
+    };
+
+    // Hands the next item to `out` in its slot, skipping any slot published
+    // empty. The slot is freed even if `out` throws.
+    template<typename F>
+    status take(F&& out) {
+        for (;;) {
+            if (auto* s = head()) {
+                struct advance_on_exit {
+                    segmented_channel& self;
+                    std::optional<T>& value;
+
+                    ~advance_on_exit() {
+                        value.reset();
+                        self.advance();
+                    }
+                } guard { *this, s->value };
+                if (!guard.value) continue;
+                out(std::move(*guard.value));
+                return status::OK;
+            }
+            else if (!_shared.disconnected.load(std::memory_order_acquire)) return status::WOULD_BLOCK;
+            // the final items may have been published after the first check
+            else if (head() == nullptr) return status::CLOSED;
+        }
+    }
+
+    recv_result<T> pop() {
+        auto r = recv_result<T>(status::WOULD_BLOCK);
+        r.result = take([&r](T&& v) { r.emplace(std::move(v)); });
+        return r;
+    }
+
+    // The consumer's current slot, if a producer has published it
+    slot* head() noexcept {
+        auto* s = _consumer.first->slots() + _consumer.offset;
+        return s->state.load(std::memory_order_acquire) ? s : nullptr;
+    }
+
+    void advance() noexcept {
+        if (++_consumer.offset < _producer.size) return;
+        // The producer of the last slot linked the next segment before
+        // publishing that slot.
+        auto* next = _consumer.first->next.load(std::memory_order_acquire);
+        _producer.recycle(std::exchange(_consumer.first, next));
+        _consumer.offset = 0;
+    }
+
+    struct consumer {
+        segment* first;
+        std::size_t offset = 0;
+    };
+
+    struct shared {
+        std::atomic_bool open = { true };
+        std::atomic_bool disconnected = { false };
+    };
+
+    struct producer : list {
+        using list::list;
+        std::atomic_ptrdiff_t count = { 1 };
+    };
+
+    alignas(detail::cache_alignment) consumer _consumer;
+    alignas(detail::cache_alignment) shared _shared;
+    alignas(detail::cache_alignment) producer _producer;
+    alignas(detail::cache_alignment) parking _recv_wait;
+};
+
+}
+
+#endif//JJC_DETAIL_MPSC_SEGMENTED_HPP
@@ -0,0 +1,76 @@
+#ifndef JJC_DETAIL_MPSC_SELECT_HPP
+#define JJC_DETAIL_MPSC_SELECT_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/wait.hpp>
+#include <optional>
+
+namespace jjc::mpsc::detail {
+
+// Waits for any of several receivers with the same protocol a single receiver
+// uses with its parking word: register as parked, re-check, then sleep. Here
+// the thread registers with every receiver's word before checking any of
+// them, and then sleeps on all of the words at once with wait_any. Where that
+// isn't available it sleeps on select_fallback instead, which every parking
+// word bumps while it has waiters.
+//
+// Anything that can't be waited on is always ready, so every receiver has a
+// parking word by the time this sleeps.
+//
+// Returns the index of the first ready receiver, or nothing if `tp` (if not
+// null) passed first.
+template<std::size_t N>
+std::optional<std::size_t> select(const std::array<selectable*, N>& rs, const std::chrono::steady_clock::time_point* tp) {
+    namespace concurrency = jjc::detail::concurrency;
+
+    const auto ready = [&rs]() -> std::optional<std::size_t> {
+        for (std::size_t i = 0; i < N; ++i) {
+            if (rs[i]->recv_ready()) return i;
+        }
+        return std::nullopt;
+    };
+
+    if (auto i = ready()) return i;
+
+    const auto shared = N > concurrency::wait_any_max();
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+        if (tp != nullptr && now >= *tp) return ready();
+
+        auto fallback_epoch = std::uint32_t(0);
+        if (shared) {
+            select_fallback::waiters.fetch_add(1, std::memory_order_seq_cst);
+            fallback_epoch = select_fallback::epoch.load(std::memory_order_seq_cst);
+        }
+        auto targets = std::array<concurrency::wait_target, N>{};
+        for (std::size_t i = 0; i < N; ++i) {
+            auto* const p = rs[i]->recv_parking();
+            targets[i] = concurrency::make_wait_target(p->word(), p->enter(true));
+        }
+
+        const auto i = ready();
+        if (!i) {
+            if (!shared) {
+                concurrency::wait_any(targets.data(), N, tp);
+            }
+            else if (tp == nullptr) {
+                concurrency::wait(&select_fallback::epoch, fallback_epoch);
+            }
+            else {
+                concurrency::wait_until(&select_fallback::epoch, fallback_epoch, *tp);
+            }
+        }
+
+        for (auto* r : rs) r->recv_parking()->leave(true);
+        if (shared) select_fallback::waiters.fetch_sub(1, std::memory_order_relaxed);
+        if (i) return i;
+    }
+}
+
+}
+
+#endif//JJC_DETAIL_MPSC_SELECT_HPP
@@ -3,11 +3,12 @@
 
 #include <atomic>
 #include <jjc/detail/mpsc_common.hpp>
-#include <jjc/event.hpp>
 #include <jjc/mutex.hpp>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
+#include <utility>
 #include <variant>
 
 namespace jjc::mpsc::detail {
@@ -17,17 +18,32 @@ namespace jjc::mpsc::detail {
 // Notifying the receiver of sender disconnects is as easy as sending an node
 // with no item, ensuring the receiver processes all current items before
 // closing itself.
+//
+// Consumed nodes are recycled rather than freed. The consumer keeps them in a
+// private stash, which is handed over to producers as a whole once their free
+// list has run dry. Producers always take the entire free list with a single
+// exchange and return what they don't use, which (unlike popping one node at a
+// time) is immune to ABA. At most `pool_high_water` nodes are pooled, counting
+// both the stash and the nodes handed over that haven't come back through the
+// queue yet; beyond that nodes are freed, so memory shrinks again after a
+// burst.
+//
+// Every node comes from `resource`, which must outlive the channel.
 template<typename T>
 struct unbounded_channel : detail::sender<T>, detail::receiver<T> {
-    unbounded_channel() :
-        _consumer { new node() },
+    explicit unbounded_channel(
+        std::size_t pool_high_water = default_pool_high_water,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    ) :
+        _resource(resource),
+        _consumer { new_object<node>(resource), pool_high_water },
         _producer { _consumer.first }
     {}
 
     ~unbounded_channel() {
-        while (_consumer.first != nullptr) {
-            delete std::exchange(_consumer.first, _consumer.first->next.load(std::memory_order_relaxed));
-        }
+        free_all(_consumer.first);
+        free_all(_consumer.stash);
+        free_all(_producer.free.load(std::memory_order_relaxed));
     }
 
     unbounded_channel(const unbounded_channel&) = delete;
@@ -38,7 +54,7 @@ struct unbounded_channel : detail::sender<T>, detail::receiver<T> {
 
     recv_result<T> receive() final {
         while (_consumer.first->next.load(std::memory_order_acquire) == nullptr) {
-            _shared.ready.wait();
+            _recv_wait.wait([this] { return recv_ready(); }, nullptr);
         }
         return pop();
     }
@@ -52,39 +68,86 @@ struct unbounded_channel : detail::sender<T>, detail::receiver<T> {
 
     recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
         while (_consumer.first->next.load(std::memory_order_acquire) == nullptr) {
-            if (!_shared.ready.wait_until(tp)) return { status::TIMEOUT };
+            if (!_recv_wait.wait([this] { return recv_ready(); }, &tp)) return { status::TIMEOUT };
         }
         return pop();
     }
 
+    parking* recv_parking() final { return &_recv_wait; }
+
+    // The final, empty node counts, as it is how the receiver sees the close
+    bool recv_ready() final {
+        return _consumer.first->next.load(std::memory_order_seq_cst) != nullptr;
+    }
+
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        std::size_t n = 0;
+        while (n < max_n) {
+            auto* const next = _consumer.first->next.load(std::memory_order_acquire);
+            if (next == nullptr) break;
+            if (!next->value) return { n, status::CLOSED };
+            retire(std::exchange(_consumer.first, next));
+            out(std::move(*next->value));
+            ++n;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
+
     send_result<T> send(T&& v) final {
         if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
 
-        auto* n = new node(std::move(v));
-        // The tail is updated first, allowing the thread that accessed it
-        // exclusive (producer-side) access to the node.
-        auto* last = _producer.last.load(std::memory_order_relaxed);
-        while (!_producer.last.compare_exchange_weak(last, n, std::memory_order_acq_rel, std::memory_order_relaxed)) {}
-        last->next.store(n, std::memory_order_release);
-
-        // Note: the thread that first "acquires" the tail may not be the first
-        // to signal. In theory that could lead to an unfortunate spurious wake
-        // for the consumer. In practice the wake takes time, so first->next is
-        // all but guaranteed to be populated.
-        _shared.ready.signal();
+        auto* n = make_node(std::move(v));
+        link(n, n);
         return { status::OK, {} };
     }
 
+    send_count send_many(std::size_t n, const source<T>& in) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+        // The chain is built privately and published with a single tail
+        // update. If producing an item throws, whatever was built so far is
+        // still sent.
+        struct link_on_exit {
+            unbounded_channel& self;
+            node* spare;
+            node* first = nullptr;
+            node* last = nullptr;
+
+            ~link_on_exit() {
+                self.put_back(spare);
+                if (first != nullptr) self.link(first, last);
+            }
+        } chain { *this, take_free() };
+
+        for (std::size_t i = 0; i < n; ++i) {
+            node* next = nullptr;
+            if (chain.spare != nullptr) {
+                in(chain.spare->value);
+                next = std::exchange(chain.spare, chain.spare->next.load(std::memory_order_relaxed));
+                next->next.store(nullptr, std::memory_order_relaxed);
+            }
+            else next = new_object<node>(_resource, in);
+            if (chain.first == nullptr) chain.first = next;
+            else chain.last->next.store(next, std::memory_order_relaxed);
+            chain.last = next;
+        }
+        return { n, status::OK };
+    }
+
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        return send_many(n, in);
+    }
+
     void connect() final {
         _producer.count.fetch_add(1, std::memory_order_relaxed);
     }
 
     void disconnect() final {
         if (1 == _producer.count.fetch_sub(1, std::memory_order_acq_rel)) {
-            auto* n = new node();
+            auto* n = new_object<node>(_resource);
             _producer.last.load(std::memory_order_relaxed)->next.store(n, std::memory_order_release);
             // _producer.last is never touched again, so it is left dangling
-            _shared.ready.signal();
+            _recv_wait.notify_one();
         }
     }
 
@@ -93,38 +156,138 @@ struct unbounded_channel : detail::sender<T>, detail::receiver<T> {
     }
 
 private:
+    // The final, empty node is never consumed, so the channel stays closed
+    // for every later receive too.
     recv_result<T> pop() {
-        std::unique_ptr<node> t{std::exchange(_consumer.first, _consumer.first->next.load(std::memory_order_relaxed))};
-        if (auto& out = _consumer.first->value) {
-            return { std::move(*out) };
-        }
-        return { status::CLOSED };
+        auto* const next = _consumer.first->next.load(std::memory_order_relaxed);
+        if (!next->value) return { status::CLOSED };
+        retire(std::exchange(_consumer.first, next));
+        return { std::move(*next->value) };
     }
 
     struct node {
         explicit node() = default;
         explicit node(T&& v) : value(std::move(v)) {}
+        explicit node(const source<T>& in) { in(value); }
         std::optional<T> value = {};
         std::atomic<node*> next = { nullptr };
+        // Set by the consumer once the node is in the pool, so it can tell
+        // when a handed-over node comes back. Producers never touch it.
+        bool pooled = false;
     };
 
+    // Appends the already linked nodes [first, last] to the queue
+    void link(node* first, node* last) {
+        // The tail is updated first, allowing the thread that accessed it
+        // exclusive (producer-side) access to the node.
+        auto* prev = _producer.last.exchange(last, std::memory_order_acq_rel);
+        prev->next.store(first, std::memory_order_release);
+
+        // Note: the thread that first "acquires" the tail may not be the first
+        // to signal. In theory that could lead to an unfortunate spurious wake
+        // for the consumer. In practice the wake takes time, so first->next is
+        // all but guaranteed to be populated.
+        _recv_wait.notify_one();
+    }
+
+    node* make_node(T&& v) {
+        auto* const n = take_free();
+        if (n == nullptr) return new_object<node>(_resource, std::move(v));
+        put_back(n->next.load(std::memory_order_relaxed));
+        n->next.store(nullptr, std::memory_order_relaxed);
+        try {
+            n->value.emplace(std::move(v));
+        }
+        catch (...) {
+            put_back(n);
+            throw;
+        }
+        return n;
+    }
+
+    // Takes the whole free list, if there is one
+    node* take_free() noexcept {
+        if (_producer.free.load(std::memory_order_relaxed) == nullptr) return nullptr;
+        return _producer.free.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    // Returns unused nodes taken with take_free()
+    void put_back(node* first) noexcept {
+        if (first == nullptr) return;
+        node* head = nullptr;
+        if (_producer.free.compare_exchange_strong(head, first, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+        // The consumer handed over a new stash in the meantime
+        auto* last = first;
+        while (auto* next = last->next.load(std::memory_order_relaxed)) last = next;
+        do {
+            last->next.store(head, std::memory_order_relaxed);
+        } while (!_producer.free.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void retire(node* n) {
+        n->value.reset();
+        if (n->pooled) --_consumer.handed;
+        if (pooled() >= _consumer.high_water) {
+            delete_object(_resource, n);
+            hand_over();
+            return;
+        }
+        n->pooled = true;
+        n->next.store(_consumer.stash, std::memory_order_relaxed);
+        _consumer.stash = n;
+        if (++_consumer.stash_count >= handoff_batch || pooled() == _consumer.high_water) hand_over();
+    }
+
+    std::size_t pooled() const noexcept {
+        return _consumer.stash_count + _consumer.handed;
+    }
+
+    // Gives the stash to producers if they have run out
+    void hand_over() noexcept {
+        if (_consumer.stash == nullptr || _producer.free.load(std::memory_order_relaxed) != nullptr) return;
+        node* expected = nullptr;
+        if (_producer.free.compare_exchange_strong(expected, _consumer.stash, std::memory_order_release, std::memory_order_relaxed)) {
+            _consumer.stash = nullptr;
+            _consumer.handed += std::exchange(_consumer.stash_count, 0);
+        }
+    }
+
+    void free_all(node* n) noexcept {
+        while (n != nullptr) {
+            delete_object(_resource, std::exchange(n, n->next.load(std::memory_order_relaxed)));
+        }
+    }
+
+    // checking on producers is only worthwhile once there's a few nodes to give
+    static constexpr std::size_t handoff_batch = 32;
+
     struct consumer {
         node* first;
+        std::size_t high_water;
+        node* stash = nullptr;
+        std::size_t stash_count = 0;
+        // nodes handed over to producers, whether on the free list, taken by
+        // a producer or still in the queue
+        std::size_t handed = 0;
     };
 
     struct shared {
         std::atomic_bool open = { true };
-        event ready = {};
     };
 
     struct producer {
         std::atomic<node*> last;
         std::atomic_ptrdiff_t count = { 1 };
+        std::atomic<node*> free = { nullptr };
     };
 
+    std::pmr::memory_resource* const _resource;
     alignas(detail::cache_alignment) consumer _consumer;
     alignas(detail::cache_alignment) shared _shared;
     alignas(detail::cache_alignment) producer _producer;
+    alignas(detail::cache_alignment) parking _recv_wait;
 };
 
 }
@@ -0,0 +1,172 @@
+#ifndef JJC_DETAIL_SEGMENT_LIST_HPP
+#define JJC_DETAIL_SEGMENT_LIST_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/spin.hpp>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <thread>
+
+namespace jjc::mpsc::detail {
+
+// The producer end of an unbounded channel that stores items in a linked list
+// of fixed-size segments rather than one node per item, shared by the mpsc and
+// mpmc segmented channels. This costs one allocation per segment instead of
+// one per item, and lets consumers walk each segment sequentially.
+//
+// Producers claim slots by advancing a shared tail index with a CAS. The low
+// bits of the index are the offset into the tail segment, and the high bits
+// count segments so that a producer holding a stale segment can never succeed.
+// Whoever claims the last slot of a segment links in the next one and moves
+// the index to its start. Until then the offset reads as `size`, and other
+// producers back off. The next segment is allocated before claiming that last
+// slot, so this window is very short.
+//
+// How slots are published, read and handed back is up to the consumer side.
+// Each slot's `state` is a `State` that reads as `State()` while the slot is
+// free, and the consumer side decides when a segment is done with and passes
+// it to recycle(). The most recently recycled segment is kept for reuse.
+// Segments come from `resource`, which must outlive the list.
+template<typename T, typename State>
+struct segment_list {
+    struct slot {
+        std::atomic<State> state = { State() };
+        std::optional<T> value = {};
+    };
+
+    // A segment header, immediately followed by its slots in the same
+    // allocation.
+    struct alignas(slot) segment {
+        std::atomic<segment*> next = { nullptr };
+
+        slot* slots() noexcept {
+            return std::launder(reinterpret_cast<slot*>(this + 1));
+        }
+
+        static segment* make(std::size_t size, std::pmr::memory_resource* resource) {
+            void* p = resource->allocate(bytes(size), alignof(segment));
+            auto* s = new (p) segment();
+            auto* first = reinterpret_cast<slot*>(s + 1);
+            for (std::size_t i = 0; i < size; ++i) new (first + i) slot();
+            return s;
+        }
+
+        static void destroy(segment* s, std::size_t size, std::pmr::memory_resource* resource) noexcept {
+            auto* first = s->slots();
+            for (std::size_t i = 0; i < size; ++i) first[i].~slot();
+            s->~segment();
+            resource->deallocate(s, bytes(size), alignof(segment));
+        }
+
+        static std::size_t bytes(std::size_t size) noexcept {
+            return sizeof(segment) + size * sizeof(slot);
+        }
+
+        // Prepares a consumed segment for reuse
+        void reset(std::size_t size) noexcept {
+            next.store(nullptr, std::memory_order_relaxed);
+            auto* first = slots();
+            for (std::size_t i = 0; i < size; ++i) first[i].state.store(State(), std::memory_order_relaxed);
+        }
+    };
+
+    struct claimed {
+        segment* seg;
+        std::size_t offset;
+        std::size_t count;
+    };
+
+    static constexpr std::uint64_t offset_mask = 0xffffffff;
+    static constexpr std::uint64_t lap = offset_mask + 1;
+
+    // The offset must fit below the lap count, with room for the "full" marker
+    static constexpr std::size_t clamp(std::size_t size) noexcept {
+        return static_cast<std::size_t>(std::clamp<std::uint64_t>(size, 1, offset_mask - 1));
+    }
+
+    static void back_off(jjc::detail::concurrency::backoff& b) noexcept {
+        if (b.pause() > 32 || !jjc::detail::concurrency::can_spin()) std::this_thread::yield();
+    }
+
+    // `first` is a segment of `size` slots from `resource`, with size already
+    // clamped
+    segment_list(segment* first, std::size_t size, std::pmr::memory_resource* resource) noexcept :
+        tail(first),
+        size(size),
+        resource(resource)
+    {}
+
+    ~segment_list() {
+        if (auto* s = spare.load(std::memory_order_relaxed)) destroy(s);
+    }
+
+    segment_list(const segment_list&) = delete;
+    segment_list& operator=(const segment_list&) = delete;
+
+    // Claims between 1 and max_n consecutive slots in the tail segment
+    claimed claim(std::size_t max_n) {
+        segment* next = nullptr;
+        auto b = jjc::detail::concurrency::backoff{};
+        auto i = index.load(std::memory_order_acquire);
+        for (;;) {
+            const auto offset = static_cast<std::size_t>(i & offset_mask);
+            if (offset == size) {
+                // another producer is linking in the next segment
+                back_off(b);
+                i = index.load(std::memory_order_acquire);
+                continue;
+            }
+
+            const auto count = std::min(max_n, size - offset);
+            const auto fills = offset + count == size;
+            if (fills && next == nullptr) next = make_segment();
+
+            // The tail is always published before the index that refers to it,
+            // and the CAS below fails if the index has moved on since.
+            auto* const t = tail.load(std::memory_order_acquire);
+            if (index.compare_exchange_weak(i, i + count, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (fills) {
+                    t->next.store(next, std::memory_order_release);
+                    tail.store(next, std::memory_order_release);
+                    index.store((i & ~offset_mask) + lap, std::memory_order_release);
+                }
+                else if (next != nullptr) recycle(next);
+                return { t, offset, count };
+            }
+        }
+    }
+
+    segment* make_segment() {
+        if (spare.load(std::memory_order_relaxed) != nullptr) {
+            if (auto* s = spare.exchange(nullptr, std::memory_order_acquire)) return s;
+        }
+        return segment::make(size, resource);
+    }
+
+    // Keeps `s` for reuse, or frees it if there already is a spare
+    void recycle(segment* s) noexcept {
+        s->reset(size);
+        segment* expected = nullptr;
+        if (!spare.compare_exchange_strong(expected, s, std::memory_order_release, std::memory_order_relaxed)) {
+            destroy(s);
+        }
+    }
+
+    void destroy(segment* s) noexcept {
+        segment::destroy(s, size, resource);
+    }
+
+    std::atomic<segment*> tail;
+    const std::size_t size;
+    std::atomic<std::uint64_t> index = { 0 };
+    std::atomic<segment*> spare = { nullptr };
+    std::pmr::memory_resource* const resource;
+};
+
+}
+
+#endif//JJC_DETAIL_SEGMENT_LIST_HPP
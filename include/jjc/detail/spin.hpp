@@ -0,0 +1,114 @@
+#ifndef JJC_DETAIL_CONCURRENCY_SPIN_HPP
+#define JJC_DETAIL_CONCURRENCY_SPIN_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace jjc::detail::concurrency {
+
+// Hints to the CPU that the caller is in a spin-wait loop.
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+    __yield();
+#elif defined(__i386__) || defined(__x86_64__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Spinning can only ever help if another thread can make progress in the
+// meantime.
+inline bool can_spin() noexcept {
+    static const bool multicore = std::thread::hardware_concurrency() > 1;
+    return multicore;
+}
+
+// Exponential backoff for CAS retry loops. Each call to pause() relaxes twice
+// as long as the previous one, up to a fixed cap.
+class backoff {
+public:
+    // returns the number of cpu_relax calls made
+    uint32_t pause() noexcept {
+        const auto n = uint32_t(1) << _step;
+        for (uint32_t i = 0; i < n; ++i) cpu_relax();
+        if (_step < max_step) ++_step;
+        return n;
+    }
+
+private:
+    static constexpr uint32_t max_step = 6;
+    uint32_t _step = 0;
+};
+
+// A bounded spin phase to run before parking a thread.
+//
+// The budget adapts to recent history: every successful spin pulls the
+// estimate towards the number of relaxes it actually needed, while every
+// failed spin (the caller went on to park) decays it. Short critical sections
+// therefore settle on a budget just long enough to catch the hand-off, while
+// long ones decay towards zero and spin only the minimum budget of min_spins
+// relaxes before parking.
+class adaptive_spin {
+public:
+    constexpr adaptive_spin() noexcept = default;
+
+    adaptive_spin(const adaptive_spin&) = delete;
+    adaptive_spin& operator =(const adaptive_spin&) = delete;
+
+    // Calls ready() after each backoff round until it returns true or the
+    // budget is exhausted. Never spins on a single core.
+    template<typename F>
+    bool spin(F&& ready) noexcept {
+        return can_spin() && run(ready);
+    }
+
+    // As spin(), but regardless of the core count
+    template<typename F>
+    bool run(F&& ready) noexcept {
+        const auto estimate = _estimate.load(std::memory_order_relaxed);
+        const auto limit = std::min(max_spins, estimate * 2 + min_spins);
+        auto b = backoff{};
+        uint32_t spins = 0;
+        while (spins < limit) {
+            spins += b.pause();
+            if (ready()) {
+                const auto delta = (static_cast<int32_t>(spins) - static_cast<int32_t>(estimate)) / 8;
+                _estimate.store(static_cast<uint32_t>(static_cast<int32_t>(estimate) + delta), std::memory_order_relaxed);
+                return true;
+            }
+        }
+        // rounds up so that the estimate can reach zero
+        _estimate.store(estimate - (estimate + 3) / 4, std::memory_order_relaxed);
+        return false;
+    }
+
+    // The number of relaxes a successful spin currently expects to need
+    uint32_t estimate() const noexcept {
+        return _estimate.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t min_spins = 16;
+    static constexpr uint32_t max_spins = 512;
+
+    std::atomic_uint32_t _estimate = { 0 };
+};
+
+}
+
+#endif//JJC_DETAIL_CONCURRENCY_SPIN_HPP
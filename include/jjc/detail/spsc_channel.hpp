@@ -0,0 +1,404 @@
+#ifndef JJC_DETAIL_SPSC_CHANNEL_HPP
+#define JJC_DETAIL_SPSC_CHANNEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <jjc/detail/mpsc_common.hpp>
+#include <jjc/detail/spin.hpp>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+namespace jjc::spsc::detail {
+
+using mpsc::blocking;
+using mpsc::recv_count;
+using mpsc::recv_result;
+using mpsc::send_count;
+using mpsc::send_result;
+using mpsc::status;
+using mpsc::detail::cache_alignment;
+using mpsc::detail::delete_object;
+using mpsc::detail::new_object;
+using mpsc::detail::object_array;
+using mpsc::detail::parking;
+using mpsc::detail::sink;
+using mpsc::detail::source;
+
+inline constexpr std::size_t default_segment_size = 64;
+
+// Fixed-size storage, indexed with a mask when the capacity is a power of two
+template<typename T>
+struct ring {
+    static constexpr bool bounded = true;
+
+    ring(std::size_t capacity, std::pmr::memory_resource* resource) :
+        _slots(capacity, resource),
+        _size(capacity),
+        _pow2((capacity & (capacity - 1)) == 0)
+    {}
+
+    std::size_t capacity() const noexcept { return _size; }
+
+    std::optional<T>& write_slot() noexcept { return _slots[index(_write)]; }
+    void wrote() noexcept { ++_write; }
+
+    std::optional<T>& read_slot() noexcept { return _slots[index(_read)]; }
+    void read() noexcept { ++_read; }
+
+private:
+    std::size_t index(std::size_t pos) const noexcept {
+        return _pow2 ? pos & (_size - 1) : pos % _size;
+    }
+
+    object_array<std::optional<T>> _slots;
+    const std::size_t _size;
+    const bool _pow2;
+    alignas(cache_alignment) std::size_t _write = 0;
+    alignas(cache_alignment) std::size_t _read = 0;
+};
+
+// A linked list of fixed-size segments. The producer links in the next
+// segment before publishing anything in it, so the consumer can follow the
+// link without further synchronization. The most recently consumed segment
+// is kept for reuse. Segments come from `resource`, which must outlive the
+// storage.
+template<typename T>
+struct segments {
+    static constexpr bool bounded = false;
+
+    segments(std::size_t segment_size, std::pmr::memory_resource* resource) :
+        _resource(resource),
+        _size(std::max<std::size_t>(segment_size, 1)),
+        _write { new_object<segment>(resource, _size, resource) },
+        _read { _write.seg }
+    {}
+
+    ~segments() {
+        for (auto* s = _read.seg; s != nullptr;) delete_object(_resource, std::exchange(s, s->next));
+        delete_object(_resource, _spare.load(std::memory_order_relaxed));
+    }
+
+    segments(const segments&) = delete;
+    segments& operator=(const segments&) = delete;
+
+    static constexpr std::size_t capacity() noexcept {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    std::optional<T>& write_slot() {
+        if (_write.offset == _size) {
+            auto* next = _spare.load(std::memory_order_relaxed) != nullptr
+                ? _spare.exchange(nullptr, std::memory_order_acquire)
+                : nullptr;
+            if (next == nullptr) next = new_object<segment>(_resource, _size, _resource);
+            _write.seg->next = next;
+            _write.seg = next;
+            _write.offset = 0;
+        }
+        return _write.seg->items[_write.offset];
+    }
+
+    void wrote() noexcept { ++_write.offset; }
+
+    std::optional<T>& read_slot() noexcept {
+        if (_read.offset == _size) {
+            auto* const done = std::exchange(_read.seg, _read.seg->next);
+            _read.offset = 0;
+            done->next = nullptr;
+            segment* expected = nullptr;
+            if (!_spare.compare_exchange_strong(expected, done, std::memory_order_release, std::memory_order_relaxed)) {
+                delete_object(_resource, done);
+            }
+        }
+        return _read.seg->items[_read.offset];
+    }
+
+    void read() noexcept { ++_read.offset; }
+
+private:
+    struct segment {
+        segment(std::size_t size, std::pmr::memory_resource* resource) : items(size, resource) {}
+        object_array<std::optional<T>> items;
+        segment* next = nullptr;
+    };
+
+    struct cursor {
+        segment* seg;
+        std::size_t offset = 0;
+    };
+
+    std::pmr::memory_resource* const _resource;
+    const std::size_t _size;
+    alignas(cache_alignment) cursor _write;
+    alignas(cache_alignment) cursor _read;
+    alignas(cache_alignment) std::atomic<segment*> _spare = { nullptr };
+};
+
+// A single-producer, single-consumer channel over either storage.
+//
+// Each side owns one counter and only ever stores to it, so publishing an
+// item or freeing a slot is a plain release store rather than a CAS. Each
+// side also caches the other's counter and only re-reads it once the cached
+// value runs out, so in the steady state they rarely touch each other's cache
+// lines.
+template<typename T, typename Storage>
+struct spsc_channel : mpsc::detail::sender<T>, mpsc::detail::receiver<T> {
+    spsc_channel(std::size_t n, std::pmr::memory_resource* resource) :
+        _storage(n, resource)
+    {}
+
+    spsc_channel(const spsc_channel&) = delete;
+    spsc_channel& operator=(const spsc_channel&) = delete;
+
+    blocking send_blocks() final { return Storage::bounded ? blocking::SOMETIMES : blocking::NEVER; }
+    blocking recv_blocks() final { return blocking::SOMETIMES; }
+
+    recv_result<T> receive() final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            wait_for_item(nullptr);
+            r = pop();
+        }
+        return r;
+    }
+
+    recv_result<T> try_receive() final {
+        return pop();
+    }
+
+    recv_result<T> try_receive_until(const std::chrono::steady_clock::time_point& tp) final {
+        auto r = pop();
+        while (status::WOULD_BLOCK == r.result) {
+            if (!wait_for_item(&tp)) return { status::TIMEOUT };
+            r = pop();
+        }
+        return r;
+    }
+
+    parking* recv_parking() final { return &_recv_wait; }
+    bool recv_ready() final { return has_item(); }
+
+    recv_count drain(std::size_t max_n, const sink<T>& out) final {
+        struct notify_on_exit {
+            spsc_channel& self;
+            ~notify_on_exit() { self.notify_space(); }
+        } notify { *this };
+
+        std::size_t n = 0;
+        while (n < max_n) {
+            const auto s = take(out);
+            if (status::CLOSED == s) return { n, status::CLOSED };
+            if (status::OK != s) break;
+            ++n;
+        }
+        return { n, n == 0 ? status::WOULD_BLOCK : status::OK };
+    }
+
+    send_result<T> send(T&& v) final {
+        return push(std::move(v), nullptr);
+    }
+
+    send_result<T> try_send(T&& v) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+        if (room() == 0) return { status::WOULD_BLOCK, std::move(v) };
+        put(std::move(v));
+        return { status::OK, {} };
+    }
+
+    send_result<T> try_send_until(T&& v, const std::chrono::steady_clock::time_point& tp) final {
+        return push(std::move(v), &tp);
+    }
+
+    send_count send_many(std::size_t n, const source<T>& in) final {
+        std::size_t sent = 0;
+        while (sent < n) {
+            if (!_shared.open.load(std::memory_order_acquire)) return { sent, status::CLOSED };
+
+            const auto count = std::min(n - sent, room());
+            if (count == 0) {
+                wait_for_space(nullptr);
+                continue;
+            }
+            put_many(count, in);
+            sent += count;
+        }
+        return { n, status::OK };
+    }
+
+    send_count try_send_many(std::size_t n, const source<T>& in) final {
+        if (!_shared.open.load(std::memory_order_acquire)) return { 0, status::CLOSED };
+
+        const auto count = std::min(n, room());
+        if (count != 0) put_many(count, in);
+        return { count, count == n ? status::OK : status::WOULD_BLOCK };
+    }
+
+    // The only sender can't be copied, so this is never called
+    void connect() final {}
+
+    void disconnect() final {
+        // Every send happens before this, so once the consumer sees the flag
+        // it has also seen every item.
+        _shared.disconnected.store(true, std::memory_order_seq_cst);
+        _recv_wait.wake_all();
+    }
+
+    void close() final {
+        _shared.open.store(false, std::memory_order_seq_cst);
+        if constexpr (Storage::bounded) _send_wait.wake_all();
+    }
+
+private:
+    // The number of items that can be sent without blocking
+    std::size_t room() noexcept {
+        if constexpr (!Storage::bounded) {
+            return _storage.capacity();
+        }
+        else {
+            const auto tail = _producer.tail.load(std::memory_order_relaxed);
+            if (tail - _producer.head_cache >= _storage.capacity()) {
+                _producer.head_cache = _consumer.head.load(std::memory_order_acquire);
+            }
+            return _storage.capacity() - (tail - _producer.head_cache);
+        }
+    }
+
+    void put(T&& v) {
+        _storage.write_slot().emplace(std::move(v));
+        _storage.wrote();
+        _producer.tail.store(_producer.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        _recv_wait.notify_one();
+    }
+
+    // Publishes `count` items with a single store. If producing an item
+    // throws, the ones before it are still sent.
+    void put_many(std::size_t count, const source<T>& in) {
+        struct publish_on_exit {
+            spsc_channel& self;
+            std::size_t filled = 0;
+
+            ~publish_on_exit() {
+                if (filled == 0) return;
+                auto& tail = self._producer.tail;
+                tail.store(tail.load(std::memory_order_relaxed) + filled, std::memory_order_release);
+                self._recv_wait.notify_one();
+            }
+        } publish { *this };
+
+        for (; publish.filled < count; ++publish.filled) {
+            in(_storage.write_slot());
+            _storage.wrote();
+        }
+    }
+
+    send_result<T> push(T&& v, const std::chrono::steady_clock::time_point* tp) {
+        while (true) {
+            if (!_shared.open.load(std::memory_order_acquire)) return { status::CLOSED, std::move(v) };
+            if (room() != 0) {
+                put(std::move(v));
+                return { status::OK, {} };
+            }
+            if (!wait_for_space(tp)) return { status::TIMEOUT, std::move(v) };
+        }
+    }
+
+    // The number of items that can be received without blocking
+    std::size_t available() noexcept {
+        const auto head = _consumer.head.load(std::memory_order_relaxed);
+        if (head == _consumer.tail_cache) {
+            _consumer.tail_cache = _producer.tail.load(std::memory_order_acquire);
+        }
+        return _consumer.tail_cache - head;
+    }
+
+    // Hands the next item to `out`. The slot is freed even if `out` throws.
+    template<typename F>
+    status take(F&& out) {
+        if (available() == 0) {
+            if (!_shared.disconnected.load(std::memory_order_acquire)) return status::WOULD_BLOCK;
+            // the final items may have been published after the first check
+            if (available() == 0) return status::CLOSED;
+        }
+
+        struct free_on_exit {
+            spsc_channel& self;
+            std::optional<T>& slot;
+
+            ~free_on_exit() {
+                slot.reset();
+                self._storage.read();
+                auto& head = self._consumer.head;
+                head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        } guard { *this, _storage.read_slot() };
+        out(std::move(*guard.slot));
+        return status::OK;
+    }
+
+    recv_result<T> pop() {
+        auto r = recv_result<T>(status::WOULD_BLOCK);
+        const auto s = take([&r](T&& v) { r.emplace(std::move(v)); });
+        if (status::OK == s) notify_space();
+        r.result = s;
+        return r;
+    }
+
+    bool has_item() noexcept {
+        return _producer.tail.load(std::memory_order_seq_cst) != _consumer.head.load(std::memory_order_relaxed) ||
+            _shared.disconnected.load(std::memory_order_seq_cst);
+    }
+
+    bool has_space() noexcept {
+        const auto tail = _producer.tail.load(std::memory_order_relaxed);
+        return tail - _consumer.head.load(std::memory_order_seq_cst) < _storage.capacity() ||
+            !_shared.open.load(std::memory_order_seq_cst);
+    }
+
+    // Returns false if tp passed before an item was published
+    bool wait_for_item(const std::chrono::steady_clock::time_point* tp) {
+        if (_consumer.spin.spin([this] { return has_item(); })) return true;
+        return _recv_wait.wait([this] { return has_item(); }, tp);
+    }
+
+    // Returns false if tp passed before a slot was freed
+    bool wait_for_space(const std::chrono::steady_clock::time_point* tp) {
+        if (_producer.spin.spin([this] { return has_space(); })) return true;
+        return _send_wait.wait([this] { return has_space(); }, tp);
+    }
+
+    void notify_space() {
+        if constexpr (Storage::bounded) _send_wait.notify_one();
+    }
+
+    struct producer {
+        std::atomic_size_t tail = { 0 };
+        std::size_t head_cache = 0;
+        jjc::detail::concurrency::adaptive_spin spin = {};
+    };
+
+    struct consumer {
+        std::atomic_size_t head = { 0 };
+        std::size_t tail_cache = 0;
+        jjc::detail::concurrency::adaptive_spin spin = {};
+    };
+
+    struct shared {
+        std::atomic_bool open = { true };
+        std::atomic_bool disconnected = { false };
+    };
+
+    alignas(cache_alignment) producer _producer;
+    alignas(cache_alignment) consumer _consumer;
+    alignas(cache_alignment) shared _shared;
+    alignas(cache_alignment) parking _recv_wait;
+    alignas(cache_alignment) parking _send_wait;
+    Storage _storage;
+};
+
+}
+
+#endif//JJC_DETAIL_SPSC_CHANNEL_HPP
@@ -3,7 +3,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <type_traits>
 
 #if !defined(_WIN32) && !defined(__linux__) && !defined(__APPLE__)
@@ -20,11 +23,49 @@ struct is_waitable : std::false_type {};
 template<typename T>
 struct is_waitable<T, std::enable_if_t<4 == sizeof(T) && std::is_trivially_copyable_v<T>>> : std::true_type {};
 
+// An absolute point in time, in nanoseconds since the epoch of the clock it is
+// measured against
+struct deadline {
+    enum clock_id { steady, system };
+
+    clock_id clock;
+    std::int64_t ns;
+};
+
 // return values are system-specific, for debugging purposes only
 int wait_impl(void* obj, void* expected) noexcept;
-int wait_for_impl(void* obj, void* expected, const std::chrono::milliseconds&) noexcept;
+int wait_until_impl(void* obj, void* expected, const deadline&) noexcept;
 int wake_impl(void* obj, uint32_t count) noexcept;
 int wake_all_impl(void* obj) noexcept;
+// Wakes up to `wake_count` waiters on `obj` and moves up to `requeue_count` of
+// the others onto `target`, where they carry on waiting as if they had waited
+// on it all along. This only happens if `obj` still holds `expected`.
+// Otherwise, or if the system can't move waiters, it wakes every waiter on
+// `obj` instead.
+int requeue_impl(void* obj, void* expected, void* target, uint32_t wake_count, uint32_t requeue_count) noexcept;
+
+// One of the words passed to wait_any
+struct wait_target {
+    const void* obj;
+    uint32_t expected;
+};
+
+// The most words wait_any can wait on at once, or 0 if the system has no way
+// to wait on several words (Linux before 5.16, and other systems).
+std::size_t wait_any_max() noexcept;
+
+// Waits until any of the words no longer holds its expected value or is woken,
+// or until `deadline` (if not null) passes. Like wait, this may also return
+// spuriously. `count` must not exceed wait_any_max().
+int wait_any(const wait_target* targets, std::size_t count, const std::chrono::steady_clock::time_point* deadline) noexcept;
+
+template<typename T>
+wait_target make_wait_target(const std::atomic<T>* obj, T expected) noexcept {
+    static_assert(is_waitable<T>::value);
+    auto t = wait_target { obj, 0 };
+    std::memcpy(&t.expected, &expected, sizeof(t.expected));
+    return t;
+}
 
 template<typename T>
 int wait(T* obj, T expected) noexcept {
@@ -38,16 +79,47 @@ int wait(std::atomic<T>* obj, T expected) {
     return wait_impl(obj, &expected);
 }
 
-template<typename T>
-int wait_for(T* obj, T expected, const std::chrono::milliseconds& d) noexcept {
+// Rounds up to whole nanoseconds, saturating rather than overflowing
+template<typename Rep, typename Period>
+std::int64_t ceil_ns(const std::chrono::duration<Rep, Period>& d) noexcept {
+    using limits = std::numeric_limits<std::int64_t>;
+    const auto ns = std::chrono::duration<long double, std::nano>(d).count();
+    if (ns >= static_cast<long double>(limits::max())) return limits::max();
+    if (ns <= static_cast<long double>(limits::min())) return limits::min();
+    return std::chrono::ceil<std::chrono::nanoseconds>(d).count();
+}
+
+// steady_clock and system_clock deadlines are waited on as they are. Any
+// other clock is measured from now and waited on as steady_clock.
+template<typename Clock, typename Duration>
+deadline make_deadline(const std::chrono::time_point<Clock, Duration>& tp) noexcept {
+    if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+        return { deadline::steady, ceil_ns(tp.time_since_epoch()) };
+    }
+    else if constexpr (std::is_same_v<Clock, std::chrono::system_clock>) {
+        return { deadline::system, ceil_ns(tp.time_since_epoch()) };
+    }
+    else {
+        const auto now = ceil_ns(std::chrono::steady_clock::now().time_since_epoch());
+        const auto left = ceil_ns(tp - Clock::now());
+        const auto max = std::numeric_limits<std::int64_t>::max();
+        return { deadline::steady, left > max - now ? max : now + left };
+    }
+}
+
+// Waits like wait, but gives up once `tp` has passed. The deadline is
+// absolute, so a caller that retries after a spurious wake can pass the same
+// one again.
+template<typename T, typename Clock, typename Duration>
+int wait_until(T* obj, T expected, const std::chrono::time_point<Clock, Duration>& tp) noexcept {
     static_assert(is_waitable<T>::value);
-    return wait_for_impl(obj, &expected, d);
+    return wait_until_impl(obj, &expected, make_deadline(tp));
 }
 
-template<typename T>
-int wait_for(std::atomic<T>* obj, T expected, const std::chrono::milliseconds& d) {
+template<typename T, typename Clock, typename Duration>
+int wait_until(std::atomic<T>* obj, T expected, const std::chrono::time_point<Clock, Duration>& tp) {
     static_assert(is_waitable<T>::value);
-    return wait_for_impl(obj, &expected, d);
+    return wait_until_impl(obj, &expected, make_deadline(tp));
 }
 
 template<typename T>
@@ -74,6 +146,12 @@ int wake_all(std::atomic<T>* obj) {
     return wake_all_impl(obj);
 }
 
+template<typename T, typename U>
+int requeue(std::atomic<T>* obj, T expected, std::atomic<U>* target, uint32_t wake_count, uint32_t requeue_count) {
+    static_assert(is_waitable<T>::value && is_waitable<U>::value);
+    return requeue_impl(obj, &expected, target, wake_count, requeue_count);
+}
+
 }
 
 #endif//JJC_DETAIL_CONCURRENCY_WAIT_HPP
\ No newline at end of file
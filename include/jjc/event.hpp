@@ -27,15 +27,15 @@ struct event {
     event& operator =(const event&) = delete;
 
     void signal() noexcept {
-        auto prev = _value.load(std::memory_order_relaxed);
-        while (true) {
-            auto event = (prev + 1) | 1;
-            if (_value.compare_exchange_strong(prev, event, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-                break;
-            }
-        }
-        // only wake if the event was unsignaled
-        if (!is_signaled(prev)) {
+        // Signaling an already signaled event leaves the value as-is, but is
+        // still a read-modify-write so that it synchronizes with the waiter
+        // that eventually observes it.
+        const auto prev = _value.fetch_or(1, std::memory_order_seq_cst);
+        // only wake if the event was unsignaled and someone may be parked on
+        // it. This pairs with the increment of _waiters in wait(): either the
+        // waiter's increment is seen here, or the waiter sees the new value
+        // and doesn't sleep.
+        if (!is_signaled(prev) && _waiters.load(std::memory_order_seq_cst) != 0) {
             detail::concurrency::wake_all(&_value);
         }
     }
@@ -50,11 +50,13 @@ struct event {
         }
 
         auto event = prev + 1;
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
         do {
             detail::concurrency::wait(&_value, prev);
             prev = _value.load(std::memory_order_relaxed);
 
         } while (prev < event);
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
 
         _value.compare_exchange_strong(event, event + 1, std::memory_order_release, std::memory_order_relaxed);
     }
@@ -76,16 +78,18 @@ struct event {
         }
 
         auto event = prev + 1;
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
         do {
-            const auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(t - Clock::now());
-            if (dt <= std::chrono::milliseconds::zero()) {
+            if (Clock::now() >= t) {
+                _waiters.fetch_sub(1, std::memory_order_relaxed);
                 return false;
             }
 
-            detail::concurrency::wait(&_value, prev);
+            detail::concurrency::wait_until(&_value, prev, t);
             prev = _value.load(std::memory_order_relaxed);
 
         } while (prev < event);
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
 
         _value.compare_exchange_strong(event, event + 1, std::memory_order_release, std::memory_order_relaxed);
         return true;
@@ -100,6 +104,10 @@ private:
     // values indicate that the event associated with the next value is
     // unsignaled.
     alignas(std::size_t) std::atomic_uint32_t _value;
+
+    // The number of threads that are (or are about to be) parked on _value,
+    // which lets signal() skip the wake syscall when nobody is asleep.
+    std::atomic_uint32_t _waiters = { 0 };
 };
 
 }
@@ -25,6 +25,8 @@ struct mutex {
     }
 
 private:
+    friend condition_variable;
+
     binary_semaphore _sem = { 1 };
 };
 
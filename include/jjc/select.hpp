@@ -0,0 +1,91 @@
+#ifndef JJC_SELECT_HPP
+#define JJC_SELECT_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <jjc/channel.hpp>
+#include <jjc/detail/mpsc_select.hpp>
+#include <optional>
+
+namespace jjc::mpsc {
+
+namespace detail {
+
+struct select_access {
+    template<typename T>
+    static selectable* get(mpsc::receiver<T>& r) noexcept {
+        return r._channel.get();
+    }
+};
+
+}
+
+/**
+ * Blocks until at least one of the receivers is ready, meaning that its next
+ * try_receive will return an item or CLOSED rather than WOULD_BLOCK. The
+ * receivers may have different item types, and may come from any kind of
+ * channel.
+ * 
+ * On Linux 5.16 and later the thread sleeps on every receiver at once with a
+ * single futex_waitv. Elsewhere it sleeps on one wake-up word that is shared
+ * by every select waiting that way, so it may wake for another thread's
+ * receivers and go back to sleep.
+ * 
+ * A rendezvous receiver (capacity 0) is ready while a sender is blocked in
+ * send() waiting for it, so a select doesn't let a try_send succeed. A sender
+ * that times out may withdraw its item before try_receive takes it, and the
+ * receiver of a jjc::mpmc channel may be reported ready for an item that
+ * another receiver then takes first, so in those cases try_receive can still
+ * return WOULD_BLOCK.
+ * 
+ * @returns the index of the first ready receiver, in argument order
+ */
+template<typename... Ts>
+std::size_t select(receiver<Ts>&... rs) {
+    static_assert(sizeof...(Ts) > 0, "select needs at least one receiver");
+    const auto all = std::array<detail::selectable*, sizeof...(Ts)>{ detail::select_access::get(rs)... };
+    return *detail::select(all, nullptr);
+}
+
+/**
+ * As select, but gives up once `timeout_at` has passed.
+ * 
+ * @returns the index of the first ready receiver, or nothing on timeout
+ */
+template<typename... Ts>
+std::optional<std::size_t> try_select_until(const std::chrono::steady_clock::time_point& timeout_at, receiver<Ts>&... rs) {
+    static_assert(sizeof...(Ts) > 0, "select needs at least one receiver");
+    const auto all = std::array<detail::selectable*, sizeof...(Ts)>{ detail::select_access::get(rs)... };
+    return detail::select(all, &timeout_at);
+}
+
+template<typename Rep, typename Period, typename... Ts>
+std::optional<std::size_t> try_select_for(const std::chrono::duration<Rep, Period>& timeout_after, receiver<Ts>&... rs) {
+    return try_select_until(std::chrono::steady_clock::now() + timeout_after, rs...);
+}
+
+template<typename Clock, typename Duration, typename... Ts>
+std::optional<std::size_t> try_select_until(const std::chrono::time_point<Clock, Duration>& timeout_at, receiver<Ts>&... rs) {
+    return try_select_for(timeout_at - Clock::now(), rs...);
+}
+
+}
+
+namespace jjc::spsc {
+
+using mpsc::select;
+using mpsc::try_select_for;
+using mpsc::try_select_until;
+
+}
+
+namespace jjc::mpmc {
+
+using mpsc::select;
+using mpsc::try_select_for;
+using mpsc::try_select_until;
+
+}
+
+#endif//JJC_SELECT_HPP
@@ -7,11 +7,14 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <jjc/detail/spin.hpp>
 #include <jjc/detail/wait.hpp>
 #include <limits>
 
 namespace jjc {
 
+class condition_variable;
+
 template<std::ptrdiff_t least_max_value = std::numeric_limits<uint32_t>::max()>
 class counting_semaphore {
 public:
@@ -35,6 +38,9 @@ public:
 
     counting_semaphore& operator =(const counting_semaphore&) = delete;
 
+    // Permits go to queued multi-permit waiters first, in the order they
+    // queued, for as long as the next one's demand can be met. Then as many
+    // single-permit waiters are woken as there are permits left for them.
     void release(std::ptrdiff_t update = 1) {
         if (update == 0) return;
         assert(update > 0 && update < max());
@@ -43,7 +49,13 @@ public:
         while (!_data.compare_exchange_weak(prev, prev.add_value(count), std::memory_order_release, std::memory_order_relaxed)) {}
         assert((prev.value + count) <= least_max_value); // update value caused semaphore to overflow least_max_value
         if (prev.waiting == 0) return;
-        detail::concurrency::wake(reinterpret_cast<uint32_t*>(&_data), std::min(count, prev.waiting));
+        if (prev.waiting & queued) grant_queued();
+
+        const auto single = prev.waiting & ~queued;
+        if (single == 0) return;
+        const auto left = _data.load(std::memory_order_relaxed).value;
+        if (left == 0) return;
+        detail::concurrency::wake(reinterpret_cast<uint32_t*>(&_data), std::min({ count, single, left }));
     }
 
     void acquire() {
@@ -53,6 +65,14 @@ public:
             _data.compare_exchange_strong(cur, cur.add(-1, 0), std::memory_order_acquire, std::memory_order_relaxed)
         ) return;
 
+        // Spin briefly before parking, a permit is often released shortly.
+        const auto spun = _spin.spin([&] {
+            cur = _data.load(std::memory_order_relaxed);
+            return cur.value != 0 &&
+                _data.compare_exchange_strong(cur, cur.add(-1, 0), std::memory_order_acquire, std::memory_order_relaxed);
+        });
+        if (spun) return;
+
         while (!_data.compare_exchange_weak(cur, cur.add(0, 1), std::memory_order_relaxed)) {}
 
         while (true) {
@@ -76,6 +96,48 @@ public:
         return false;
     }
 
+    /**
+     * Takes `n` permits at once, waiting until that many are available. Not
+     * part of the standard interface.
+     */
+    void acquire(std::ptrdiff_t n) {
+        if (n == 1) acquire();
+        else take(n, static_cast<const std::chrono::steady_clock::time_point*>(nullptr));
+    }
+
+    /**
+     * Takes `n` permits at once if that many are available. Not part of the
+     * standard interface.
+     */
+    bool try_acquire(std::ptrdiff_t n) noexcept {
+        assert(n >= 0 && n <= max());
+        auto cur = _data.load(std::memory_order_relaxed);
+        while (cur.value >= n) {
+            if (_data.compare_exchange_weak(cur, cur.sub_value(static_cast<uint32_t>(n)), std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Takes as many permits as are available, up to `n`, in a single atomic
+     * update without blocking. Not part of the standard interface.
+     * 
+     * @returns the number of permits taken
+     */
+    std::ptrdiff_t try_acquire_up_to(std::ptrdiff_t n) noexcept {
+        assert(n >= 0);
+        auto cur = _data.load(std::memory_order_relaxed);
+        while (cur.value != 0 && n != 0) {
+            const auto count = static_cast<uint32_t>(std::min<std::ptrdiff_t>(cur.value, n));
+            if (_data.compare_exchange_weak(cur, cur.sub_value(count), std::memory_order_acquire, std::memory_order_relaxed)) {
+                return count;
+            }
+        }
+        return 0;
+    }
+
     template<typename Rep, typename Period>
     bool try_acquire_for(const std::chrono::duration<Rep, Period>& d) {
         const auto t = std::chrono::steady_clock::now() + d;
@@ -93,13 +155,12 @@ public:
         while (!_data.compare_exchange_weak(cur, cur.add(0, 1), std::memory_order_relaxed)) {}
 
         while (true) {
-            const auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(t - Clock::now());
-            if (dt <= std::chrono::milliseconds::zero()) {
+            if (Clock::now() >= t) {
                 while (!_data.compare_exchange_weak(cur, cur.add(0, -1), std::memory_order_relaxed)) {}
                 return false;
             }
             if (cur.value == 0) {
-                detail::concurrency::wait_for(reinterpret_cast<uint32_t*>(&_data), cur.value, dt);
+                detail::concurrency::wait_until(reinterpret_cast<uint32_t*>(&_data), cur.value, t);
                 cur = _data.load(std::memory_order_relaxed);
             }
             else if (_data.compare_exchange_strong(cur, cur.add(-1, -1), std::memory_order_acquire, std::memory_order_relaxed)) {
@@ -108,18 +169,149 @@ public:
         }
     }
 
+    template<typename Rep, typename Period>
+    bool try_acquire_for(std::ptrdiff_t n, const std::chrono::duration<Rep, Period>& d) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return try_acquire_until(n, t);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_acquire_until(std::ptrdiff_t n, const std::chrono::time_point<Clock, Duration>& t) {
+        if (n == 1) return try_acquire_until(t);
+        return take(n, &t);
+    }
+
 private:
+    // Set in data::waiting while any multi-permit waiter is queued
+    static constexpr uint32_t queued = uint32_t(1) << 31;
+
+    // A thread waiting for more than one permit. A release takes the permits
+    // on its behalf and then sets `granted`.
+    struct waiter {
+        uint32_t n;
+        waiter* next = nullptr;
+        std::atomic_uint32_t granted = { 0 };
+    };
+
+    // Guards the queue of multi-permit waiters, so is only ever taken while
+    // there are some
+    class queue_lock {
+    public:
+        void lock() noexcept {
+            uint32_t c = 0;
+            if (_state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed)) return;
+            if (c != 2) c = _state.exchange(2, std::memory_order_acquire);
+            while (c != 0) {
+                detail::concurrency::wait(&_state, uint32_t(2));
+                c = _state.exchange(2, std::memory_order_acquire);
+            }
+        }
+
+        void unlock() noexcept {
+            if (2 == _state.exchange(0, std::memory_order_release)) detail::concurrency::wake(&_state, 1);
+        }
+
+    private:
+        // 0 = unlocked, 1 = locked, 2 = locked with waiters
+        std::atomic_uint32_t _state = { 0 };
+    };
+
+    template<typename Clock, typename Duration>
+    bool take(std::ptrdiff_t n, const std::chrono::time_point<Clock, Duration>* t) {
+        if (try_acquire(n)) return true;
+        if (_spin.spin([&] { return try_acquire(n); })) return true;
+
+        auto w = waiter { static_cast<uint32_t>(n) };
+        _queue.lock();
+        // Either the permits turn up before the flag is set, or the release
+        // that adds them sees the flag and takes the queue lock after this
+        auto cur = _data.load(std::memory_order_relaxed);
+        while (true) {
+            if (cur.value >= w.n) {
+                if (_data.compare_exchange_weak(cur, cur.sub_value(w.n), std::memory_order_acquire, std::memory_order_relaxed)) {
+                    _queue.unlock();
+                    return true;
+                }
+            }
+            else if (_data.compare_exchange_weak(cur, cur.set_waiting(cur.waiting | queued), std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        (_tail != nullptr ? _tail->next : _head) = &w;
+        _tail = &w;
+        _queue.unlock();
+
+        while (w.granted.load(std::memory_order_acquire) == 0) {
+            if (t != nullptr && Clock::now() >= *t) {
+                _queue.lock();
+                const auto granted = w.granted.load(std::memory_order_relaxed) != 0;
+                if (!granted) {
+                    // Permits that were held back for this waiter may already
+                    // cover the demands of the ones queued behind it
+                    unqueue(&w);
+                    grant_locked();
+                }
+                _queue.unlock();
+                return granted;
+            }
+            if (t == nullptr) detail::concurrency::wait(&w.granted, uint32_t(0));
+            else detail::concurrency::wait_until(&w.granted, uint32_t(0), *t);
+        }
+        // the release that granted the permits is done with `w` once it lets
+        // go of the queue
+        _queue.lock();
+        _queue.unlock();
+        return true;
+    }
+
+    // With the queue locked
+    void unqueue(waiter* w) noexcept {
+        waiter* prev = nullptr;
+        for (auto* it = _head; it != w; it = it->next) prev = it;
+        (prev != nullptr ? prev->next : _head) = w->next;
+        if (_tail == w) _tail = prev;
+        if (_head != nullptr) return;
+
+        auto cur = _data.load(std::memory_order_relaxed);
+        while (!_data.compare_exchange_weak(cur, cur.set_waiting(cur.waiting & ~queued), std::memory_order_relaxed)) {}
+    }
+
+    void grant_queued() {
+        _queue.lock();
+        grant_locked();
+        _queue.unlock();
+    }
+
+    // With the queue locked
+    void grant_locked() noexcept {
+        auto cur = _data.load(std::memory_order_relaxed);
+        while (_head != nullptr && cur.value >= _head->n) {
+            if (!_data.compare_exchange_weak(cur, cur.sub_value(_head->n), std::memory_order_acq_rel, std::memory_order_relaxed)) continue;
+            auto* const w = _head;
+            unqueue(w);
+            w->granted.store(1, std::memory_order_release);
+            detail::concurrency::wake(&w->granted, 1);
+            cur = _data.load(std::memory_order_relaxed);
+        }
+    }
+
     struct data {
         uint32_t value;
         uint32_t waiting;
 
         data add(int v, int w) const { return { value + v, waiting + w}; }
         data add_value(uint32_t count) const { return { value + count, waiting }; }
+        data sub_value(uint32_t count) const { return { value - count, waiting }; }
+        data set_waiting(uint32_t w) const { return { value, w }; }
     };
 
     static_assert(std::atomic<data>::is_always_lock_free);
 
     std::atomic<data> _data;
+    detail::concurrency::adaptive_spin _spin = {};
+    queue_lock _queue = {};
+    waiter* _head = nullptr;
+    waiter* _tail = nullptr;
 };
 
 template<>
@@ -154,14 +346,30 @@ public:
         // correctness.
         auto next = 0;
         auto prev = _value.load(std::memory_order_relaxed);
+        if (prev == 1 && _value.compare_exchange_strong(prev, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return;
+        }
+
+        // Spin briefly before parking. Taking the semaphore straight to 0 here
+        // is safe even if there are waiters; one of them has been (or will be)
+        // woken and will put it back into the waiting state.
+        const auto spun = _spin.spin([&] {
+            prev = _value.load(std::memory_order_relaxed);
+            return prev == 1 && _value.compare_exchange_strong(prev, next, std::memory_order_acq_rel, std::memory_order_relaxed);
+        });
+        if (spun) return;
+
         while (true) {
             if (prev == 1 && _value.compare_exchange_strong(prev, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
                 // Acquired
                 return;
             }
             if (prev == -1 || _value.compare_exchange_strong(prev, -1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                // Wait on -1 rather than prev: after a successful exchange
+                // prev is still the old value, and the semaphore could return
+                // to it (released and re-acquired) before this parks.
                 next = -1;
-                detail::concurrency::wait(&_value, prev);
+                detail::concurrency::wait(&_value, -1);
                 prev = _value.load(std::memory_order_relaxed);
             }
         }
@@ -187,24 +395,43 @@ public:
                 return true;
             }
             if (prev == -1 || _value.compare_exchange_strong(prev, -1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-                const auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(t - Clock::now());
-                if (dt <= std::chrono::milliseconds::zero()) {
+                if (Clock::now() >= t) {
                     // Leaves the semaphore in the waiting state, which is
                     // guaranteed to incur and additional wake call.
                     return false;
                 }
                 next = -1;
-                detail::concurrency::wait_for(&_value, prev, dt);
+                detail::concurrency::wait_until(&_value, -1, t);
                 prev = _value.load(std::memory_order_relaxed);
             }
         }
     }
 
 private:
+    friend condition_variable;
+
+    // Acquires as a thread that had already parked would, putting the
+    // semaphore back into the waiting state. condition_variable moves waiters
+    // straight onto the semaphore without going through that state, so this
+    // makes sure that the next release wakes one of them.
+    void acquire_parked() {
+        auto prev = _value.load(std::memory_order_relaxed);
+        while (true) {
+            if (prev == 1 && _value.compare_exchange_strong(prev, -1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return;
+            }
+            if (prev == -1 || _value.compare_exchange_strong(prev, -1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                detail::concurrency::wait(&_value, -1);
+                prev = _value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
     //  1 = available
     //  0 = unavailable, no wait
     // -1 = unavailable, waiting
     alignas(std::size_t) std::atomic_int _value;
+    detail::concurrency::adaptive_spin _spin = {};
 };
 
 using binary_semaphore = counting_semaphore<1>;
@@ -0,0 +1,136 @@
+#ifndef JJC_SHARDED_SEMAPHORE_HPP
+#define JJC_SHARDED_SEMAPHORE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/spin.hpp>
+#include <jjc/detail/wait.hpp>
+#include <limits>
+
+namespace jjc {
+
+// A counting semaphore for pools of permits that many cores draw on at once.
+//
+// Permits are kept in several stripes, each on a cache line of its own, and
+// each thread always releases into the same stripe and tries it first when
+// acquiring. If its own stripe is empty, a thread steals from the others in
+// turn. A permit can be taken from any stripe, so threads that only acquire
+// still find every permit that is released.
+//
+// Only when every stripe is empty does an acquirer count itself as waiting and
+// park on a central word. A release only touches that word when someone is
+// waiting. Each side writes its own word before it reads the other's, so either
+// the release sees the waiter, or the waiter's scan sees the permit.
+class sharded_semaphore {
+public:
+    static constexpr std::size_t stripes = 16;
+
+    static constexpr std::ptrdiff_t max() noexcept {
+        return std::numeric_limits<std::ptrdiff_t>::max();
+    }
+
+    // The initial permits are shared out between the stripes
+    explicit sharded_semaphore(std::ptrdiff_t desired) {
+        assert(desired >= 0);
+        const auto n = static_cast<std::size_t>(desired);
+        for (std::size_t i = 0; i < stripes; ++i) {
+            _stripes[i].permits.store(static_cast<std::ptrdiff_t>(n / stripes + (i < n % stripes ? 1 : 0)), std::memory_order_relaxed);
+        }
+    }
+
+    sharded_semaphore(const sharded_semaphore&) = delete;
+
+    sharded_semaphore& operator =(const sharded_semaphore&) = delete;
+
+    void release(std::ptrdiff_t update = 1) {
+        if (update == 0) return;
+        assert(update > 0);
+        _stripes[home()].permits.fetch_add(update, std::memory_order_seq_cst);
+        const auto waiting = _waiting.load(std::memory_order_seq_cst);
+        if (waiting == 0) return;
+        _wake_seq.fetch_add(1, std::memory_order_release);
+        detail::concurrency::wake(&_wake_seq, static_cast<uint32_t>(std::min<std::ptrdiff_t>(update, waiting)));
+    }
+
+    void acquire() {
+        take(static_cast<const std::chrono::steady_clock::time_point*>(nullptr));
+    }
+
+    bool try_acquire() noexcept {
+        return take_any(std::memory_order_relaxed);
+    }
+
+    template<typename Rep, typename Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period>& d) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return try_acquire_until(t);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_acquire_until(const std::chrono::time_point<Clock, Duration>& t) {
+        return take(&t);
+    }
+
+private:
+    struct alignas(64) stripe {
+        std::atomic_ptrdiff_t permits = { 0 };
+    };
+
+    // Threads are given stripes in turn as they first use the semaphore
+    static std::size_t home() noexcept {
+        static std::atomic_size_t next = { 0 };
+        thread_local const auto index = next.fetch_add(1, std::memory_order_relaxed) % stripes;
+        return index;
+    }
+
+    static bool take_from(stripe& s, std::memory_order order) noexcept {
+        auto n = s.permits.load(order);
+        while (n > 0) {
+            if (s.permits.compare_exchange_weak(n, n - 1, std::memory_order_acquire, std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    // Tries the thread's own stripe first, then steals from the rest
+    bool take_any(std::memory_order order) noexcept {
+        const auto first = home();
+        for (std::size_t i = 0; i < stripes; ++i) {
+            if (take_from(_stripes[(first + i) % stripes], order)) return true;
+        }
+        return false;
+    }
+
+    template<typename Clock, typename Duration>
+    bool take(const std::chrono::time_point<Clock, Duration>* t) {
+        if (take_any(std::memory_order_relaxed)) return true;
+        if (_spin.spin([this] { return take_any(std::memory_order_relaxed); })) return true;
+
+        _waiting.fetch_add(1, std::memory_order_seq_cst);
+        while (true) {
+            const auto seq = _wake_seq.load(std::memory_order_seq_cst);
+            if (take_any(std::memory_order_seq_cst)) break;
+            if (t != nullptr && Clock::now() >= *t) {
+                _waiting.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (t == nullptr) detail::concurrency::wait(&_wake_seq, seq);
+            else detail::concurrency::wait_until(&_wake_seq, seq, *t);
+        }
+        _waiting.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    stripe _stripes[stripes] = {};
+    // Acquirers that found every stripe empty, and the word they park on
+    alignas(64) std::atomic_ptrdiff_t _waiting = { 0 };
+    std::atomic_uint32_t _wake_seq = { 0 };
+    detail::concurrency::adaptive_spin _spin = {};
+};
+
+}
+
+#endif//JJC_SHARDED_SEMAPHORE_HPP
@@ -0,0 +1,229 @@
+#ifndef JJC_SHARED_MUTEX_HPP
+#define JJC_SHARED_MUTEX_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <jjc/detail/spin.hpp>
+#include <jjc/detail/wait.hpp>
+#include <jjc/mutex.hpp>
+
+namespace jjc {
+
+// Which side a shared_mutex favours when readers and a writer both want it
+enum class lock_preference {
+    // A waiting writer holds back new readers, so writers can't be starved
+    WRITERS,
+    // A writer waits until no reader holds the lock, so readers never wait for
+    // a writer that hasn't got in yet
+    READERS
+};
+
+// A reader-writer lock meeting the SharedTimedMutex requirements.
+//
+// Readers are counted in several stripes, each on a cache line of its own, and
+// each thread always counts in the same stripe. A shared lock increments the
+// thread's stripe and then reads the state word, which only changes when a
+// writer comes along. So readers on different cores don't write to a common
+// cache line. A writer sets the state first and then waits for every stripe to
+// drain, and a reader that finds it set backs out again and parks on the state.
+// Each side writes its own word before it reads the other's, so at least one of
+// them always sees the other.
+//
+// Writers take turns through a jjc::mutex, so only one of them at a time deals
+// with the readers.
+class shared_mutex {
+public:
+    static constexpr std::size_t stripes = 16;
+
+    shared_mutex() noexcept = default;
+
+    explicit shared_mutex(lock_preference preference) noexcept :
+        _preference(preference)
+    {}
+
+    shared_mutex(const shared_mutex&) = delete;
+
+    shared_mutex& operator =(const shared_mutex&) = delete;
+
+    void lock() {
+        _writers.lock();
+        take_exclusive(no_deadline);
+    }
+
+    bool try_lock() {
+        if (!_writers.try_lock()) return false;
+        _state.fetch_or(held, std::memory_order_seq_cst);
+        if (drained()) return true;
+        unlock();
+        return false;
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& d) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return try_lock_until(t);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& t) {
+        if (!_writers.try_lock_until(t)) return false;
+        if (take_exclusive(&t)) return true;
+        _writers.unlock();
+        return false;
+    }
+
+    void unlock() {
+        withdraw(held | pending);
+        _writers.unlock();
+    }
+
+    void lock_shared() {
+        take_shared(no_deadline);
+    }
+
+    bool try_lock_shared() {
+        auto& s = stripe();
+        s.count.fetch_add(1, std::memory_order_seq_cst);
+        if ((_state.load(std::memory_order_seq_cst) & held) == 0) return true;
+        leave(s);
+        return false;
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& d) {
+        const auto t = std::chrono::steady_clock::now() + d;
+        return try_lock_shared_until(t);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& t) {
+        return take_shared(&t);
+    }
+
+    void unlock_shared() {
+        leave(stripe());
+    }
+
+private:
+    // a writer holds the lock, or is waiting for readers to leave it
+    static constexpr uint32_t held = 1;
+    // readers are parked on the state until the writer is done
+    static constexpr uint32_t parked = 2;
+    // a writer is waiting for readers to leave before it sets `held`
+    static constexpr uint32_t pending = 4;
+
+    static constexpr const std::chrono::steady_clock::time_point* no_deadline = nullptr;
+
+    struct alignas(64) reader_stripe {
+        std::atomic_uint32_t count = { 0 };
+    };
+
+    // Threads are given stripes in turn as they first take a shared lock
+    reader_stripe& stripe() noexcept {
+        static std::atomic_size_t next = { 0 };
+        thread_local const auto index = next.fetch_add(1, std::memory_order_relaxed) % stripes;
+        return _readers[index];
+    }
+
+    bool drained() noexcept {
+        for (auto& s : _readers) {
+            if (s.count.load(std::memory_order_seq_cst) != 0) return false;
+        }
+        return true;
+    }
+
+    template<typename Clock, typename Duration>
+    static bool expired(const std::chrono::time_point<Clock, Duration>* t) {
+        return t != nullptr && Clock::now() >= *t;
+    }
+
+    template<typename Clock, typename Duration, typename U>
+    static void park(std::atomic<U>* word, U expected, const std::chrono::time_point<Clock, Duration>* t) noexcept {
+        if (t == nullptr) detail::concurrency::wait(word, expected);
+        else detail::concurrency::wait_until(word, expected, *t);
+    }
+
+    // Clears `bits` from the state, waking any readers parked on it
+    void withdraw(uint32_t bits) {
+        if (_state.fetch_and(~(bits | parked), std::memory_order_release) & parked) {
+            detail::concurrency::wake_all(&_state);
+        }
+    }
+
+    void leave(reader_stripe& s) {
+        if (s.count.fetch_sub(1, std::memory_order_seq_cst) == 1 && (_state.load(std::memory_order_seq_cst) & (held | pending)) != 0) {
+            detail::concurrency::wake(&s.count, 1);
+        }
+    }
+
+    // Waits for every stripe to drain, or returns false if `t` passes first
+    template<typename Clock, typename Duration>
+    bool wait_drained(const std::chrono::time_point<Clock, Duration>* t) {
+        for (auto& s : _readers) {
+            auto n = s.count.load(std::memory_order_seq_cst);
+            if (n == 0) continue;
+            if (_spin.spin([&] { return s.count.load(std::memory_order_seq_cst) == 0; })) continue;
+            for (n = s.count.load(std::memory_order_seq_cst); n != 0; n = s.count.load(std::memory_order_seq_cst)) {
+                if (expired(t)) return false;
+                park(&s.count, n, t);
+            }
+        }
+        return true;
+    }
+
+    // With the writers' turn held. Preferring writers, `held` is set right
+    // away and new readers back out while the current ones drain. Preferring
+    // readers, the writer only sets `held` once it has seen no readers, and
+    // tries again if one got in anyway.
+    template<typename Clock, typename Duration>
+    bool take_exclusive(const std::chrono::time_point<Clock, Duration>* t) {
+        const auto claim = lock_preference::WRITERS == _preference ? held : pending;
+        _state.fetch_or(claim, std::memory_order_seq_cst);
+        while (true) {
+            if (!wait_drained(t)) {
+                withdraw(held | pending);
+                return false;
+            }
+            if (claim == held) return true;
+
+            _state.fetch_or(held, std::memory_order_seq_cst);
+            if (drained()) {
+                _state.fetch_and(~pending, std::memory_order_relaxed);
+                return true;
+            }
+            withdraw(held);
+        }
+    }
+
+    template<typename Clock, typename Duration>
+    bool take_shared(const std::chrono::time_point<Clock, Duration>* t) {
+        auto& s = stripe();
+        while (true) {
+            s.count.fetch_add(1, std::memory_order_seq_cst);
+            auto cur = _state.load(std::memory_order_seq_cst);
+            if ((cur & held) == 0) return true;
+            leave(s);
+
+            if (_spin.spin([&] { return (_state.load(std::memory_order_relaxed) & held) == 0; })) continue;
+            cur = _state.load(std::memory_order_relaxed);
+            while (cur & held) {
+                if (expired(t)) return false;
+                if ((cur & parked) == 0 && !_state.compare_exchange_weak(cur, cur | parked, std::memory_order_relaxed)) continue;
+                park(&_state, cur | parked, t);
+                cur = _state.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    reader_stripe _readers[stripes] = {};
+    alignas(64) std::atomic_uint32_t _state = { 0 };
+    const lock_preference _preference = lock_preference::WRITERS;
+    mutex _writers = {};
+    detail::concurrency::adaptive_spin _spin = {};
+};
+
+}
+
+#endif//JJC_SHARED_MUTEX_HPP
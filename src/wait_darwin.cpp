@@ -1,8 +1,10 @@
 #include <jjc/detail/wait.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 
 // disclaimer: this is untested, entirely based off of Apple's BSD sources
 
@@ -24,8 +26,6 @@ constexpr uint32_t wake_all_flag = 1 << 2;
 // timeout
 constexpr uint32_t infinite = 0;
 
-using microseconds = std::chrono::duration<uint32_t, std::micro>;
-
 }
 
 namespace jjc::detail::concurrency {
@@ -36,12 +36,19 @@ int wait_impl(void* obj, void* expected) noexcept {
     return __ulock_wait(compare_and_wait, obj, e, infinite);
 }
 
-int wait_for_impl(void* obj, void* expected, const std::chrono::milliseconds& d) noexcept {
+// ulock timeouts are relative, in microseconds, so the time left is measured
+// against the deadline's clock. It is rounded up, both so as not to wake
+// early and because 0 would mean no timeout at all.
+int wait_until_impl(void* obj, void* expected, const deadline& d) noexcept {
     uint64_t e;
     std::memcpy(&e, expected, 4);
-    if (d == std::chrono::milliseconds::zero()) return 1;
-    const auto us = std::chrono::duration_cast<microseconds>(d);
-    return __ulock_wait(compare_and_wait, obj, e, us.count());
+    const auto now = d.clock == deadline::system
+        ? ceil_ns(std::chrono::system_clock::now().time_since_epoch())
+        : ceil_ns(std::chrono::steady_clock::now().time_since_epoch());
+    if (d.ns <= now) return 1;
+    const auto left = d.ns - now;
+    const auto us = std::min<int64_t>(left / 1000 + (left % 1000 != 0), std::numeric_limits<uint32_t>::max());
+    return __ulock_wait(compare_and_wait, obj, e, static_cast<uint32_t>(us));
 }
 
 int wake_impl(void* obj, uint32_t count) noexcept {
@@ -53,4 +60,18 @@ int wake_all_impl(void* obj) noexcept {
     return __ulock_wake(compare_and_wait | wake_all_flag, obj, 0);
 }
 
+// there is no ulock operation that moves waiters between addresses
+int requeue_impl(void* obj, void*, void*, uint32_t, uint32_t) noexcept {
+    return wake_all_impl(obj);
+}
+
+// there is no ulock operation that waits on more than one address
+std::size_t wait_any_max() noexcept {
+    return 0;
+}
+
+int wait_any(const wait_target*, std::size_t, const std::chrono::steady_clock::time_point*) noexcept {
+    return -1;
+}
+
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include <jjc/detail/wait.hpp>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <ctime>
 #include <limits>
 #include <linux/futex.h>
 #include <sys/syscall.h>
@@ -10,6 +13,18 @@
 #if !defined(FUTEX_PRIVATE_FLAG)
 #define FUTEX_WAIT_PRIVATE FUTEX_WAIT
 #define FUTEX_WAKE_PRIVATE FUTEX_WAKE
+#define FUTEX_WAIT_BITSET_PRIVATE FUTEX_WAIT_BITSET
+#define FUTEX_CMP_REQUEUE_PRIVATE FUTEX_CMP_REQUEUE
+#define FUTEX_PRIVATE_FLAG 0
+#endif
+
+// futex_waitv arrived in Linux 5.16, so older headers may not define it
+#if !defined(SYS_futex_waitv)
+#define SYS_futex_waitv 449
+#endif
+
+#if !defined(FUTEX_32)
+#define FUTEX_32 2
 #endif
 
 namespace jjc::detail::concurrency {
@@ -25,13 +40,24 @@ int wait_impl(void* obj, void* expected) noexcept {
     return futex(obj, FUTEX_WAIT_PRIVATE, e, nullptr, nullptr, 0);
 }
 
-int wait_for_impl(void* obj, void* expected, const std::chrono::milliseconds& d) noexcept {    
+namespace {
+
+timespec to_timespec(std::int64_t ns) noexcept {
+    // a deadline before the epoch has passed all the same
+    if (ns < 0) ns = 0;
+    return { static_cast<time_t>(ns / 1'000'000'000), static_cast<long>(ns % 1'000'000'000) };
+}
+
+}
+
+// FUTEX_WAIT_BITSET takes an absolute timeout, against CLOCK_MONOTONIC (which
+// steady_clock uses) unless FUTEX_CLOCK_REALTIME asks for system_clock's.
+int wait_until_impl(void* obj, void* expected, const deadline& d) noexcept {
     uint32_t e;
     std::memcpy(&e, expected, sizeof(e));
-    const auto s = std::chrono::duration_cast<std::chrono::seconds>(d);
-    const auto n = std::chrono::duration_cast<std::chrono::nanoseconds>(d - s);
-    const auto t = timespec { s.count(), n.count() };
-    return futex(obj, FUTEX_WAIT_PRIVATE, e, &t, nullptr, 0);
+    const auto t = to_timespec(d.ns);
+    const auto op = FUTEX_WAIT_BITSET_PRIVATE | (d.clock == deadline::system ? FUTEX_CLOCK_REALTIME : 0);
+    return futex(obj, op, e, &t, nullptr, FUTEX_BITSET_MATCH_ANY);
 }
 
 int wake_impl(void* obj, uint32_t count) noexcept {
@@ -42,4 +68,52 @@ int wake_all_impl(void* obj) noexcept {
     return wake_impl(obj, std::numeric_limits<int>::max());
 }
 
+// FUTEX_CMP_REQUEUE takes the number to move in place of the timeout. It fails
+// with EAGAIN if `obj` no longer holds `expected`.
+int requeue_impl(void* obj, void* expected, void* target, uint32_t wake_count, uint32_t requeue_count) noexcept {
+    uint32_t e;
+    std::memcpy(&e, expected, sizeof(e));
+    const auto n = std::min<uint32_t>(requeue_count, std::numeric_limits<int>::max());
+    const auto* const val2 = reinterpret_cast<const timespec*>(static_cast<uintptr_t>(n));
+    const auto r = futex(obj, FUTEX_CMP_REQUEUE_PRIVATE, wake_count, val2, static_cast<int*>(target), static_cast<int>(e));
+    if (r == -1 && errno == EAGAIN) return wake_all_impl(obj);
+    return r;
+}
+
+namespace {
+
+// struct futex_waitv, which older headers don't have
+struct waitv_entry {
+    uint64_t val;
+    uint64_t uaddr;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+constexpr std::size_t waitv_max = 128;
+
+}
+
+std::size_t wait_any_max() noexcept {
+    static const auto max = [] {
+        // With no words the call fails with EINVAL, unless the kernel (or a
+        // seccomp filter) doesn't know it at all.
+        syscall(SYS_futex_waitv, nullptr, 0, 0, nullptr, 0);
+        return errno == EINVAL ? waitv_max : 0;
+    }();
+    return max;
+}
+
+int wait_any(const wait_target* targets, std::size_t count, const std::chrono::steady_clock::time_point* deadline) noexcept {
+    waitv_entry entries[waitv_max];
+    for (std::size_t i = 0; i < count; ++i) {
+        entries[i] = { targets[i].expected, reinterpret_cast<uintptr_t>(targets[i].obj), FUTEX_32 | FUTEX_PRIVATE_FLAG, 0 };
+    }
+    if (deadline == nullptr) return syscall(SYS_futex_waitv, entries, count, 0, nullptr, CLOCK_MONOTONIC);
+
+    // the timeout is absolute, and steady_clock is CLOCK_MONOTONIC
+    const auto t = to_timespec(ceil_ns(deadline->time_since_epoch()));
+    return syscall(SYS_futex_waitv, entries, count, 0, &t, CLOCK_MONOTONIC);
+}
+
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include <jjc/detail/wait.hpp>
 
+#include <algorithm>
+#include <chrono>
+
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
@@ -9,8 +12,16 @@ int wait_impl(void* obj, void* expected) noexcept {
     return WaitOnAddress(obj, expected, sizeof(int), INFINITE);
 }
 
-int wait_for_impl(void* obj, void* expected, const std::chrono::milliseconds& d) noexcept {
-    return WaitOnAddress(obj, expected, sizeof(int), static_cast<DWORD>(d.count()));
+// WaitOnAddress takes a relative timeout in milliseconds, so the time left is
+// measured against the deadline's clock and rounded up
+int wait_until_impl(void* obj, void* expected, const deadline& d) noexcept {
+    const auto now = d.clock == deadline::system
+        ? ceil_ns(std::chrono::system_clock::now().time_since_epoch())
+        : ceil_ns(std::chrono::steady_clock::now().time_since_epoch());
+    if (d.ns <= now) return FALSE;
+    const auto left = d.ns - now;
+    const auto ms = (std::min<int64_t>)(left / 1'000'000 + (left % 1'000'000 != 0), INFINITE - 1);
+    return WaitOnAddress(obj, expected, sizeof(int), static_cast<DWORD>(ms));
 }
 
 int wake_impl(void* obj, uint32_t count) noexcept {
@@ -24,4 +35,19 @@ int wake_all_impl(void* obj) noexcept {
     return 1;
 }
 
+// there is no way to move waiters between addresses
+int requeue_impl(void* obj, void*, void*, uint32_t, uint32_t) noexcept {
+    WakeByAddressAll(obj);
+    return 1;
+}
+
+// WaitOnAddress only takes one address
+std::size_t wait_any_max() noexcept {
+    return 0;
+}
+
+int wait_any(const wait_target*, std::size_t, const std::chrono::steady_clock::time_point*) noexcept {
+    return -1;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <jjc/barrier.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("barrier", "[primitive]") {
+    const auto strategies = { jjc::barrier_arrival::COUNTER, jjc::barrier_arrival::TREE };
+
+    SECTION("basic invariants") {
+        for (const auto arrival : strategies) {
+            int phases = 0;
+            jjc::barrier b { 1, arrival, [&]() noexcept { ++phases; } };
+            b.arrive_and_wait();
+            b.arrive_and_wait();
+            b.wait(b.arrive());
+            REQUIRE(3 == phases);
+
+            jjc::barrier b2 { 2, arrival };
+            // a single call can count for several arrivals
+            b2.wait(b2.arrive(2));
+        }
+    }
+
+    SECTION("every phase sees every arrival") {
+        constexpr auto phases = 200;
+        for (const auto arrival : strategies) {
+            for (const auto count : { 2, 5, 8, 13 }) {
+                std::atomic_int arrived = { 0 };
+                int completed = 0;
+                bool complete = true;
+                jjc::barrier b { count, arrival, [&]() noexcept {
+                    complete = complete && arrived.exchange(0) == count;
+                    ++completed;
+                } };
+
+                auto threads = std::vector<std::thread>();
+                for (int i = 0; i < count; ++i) threads.emplace_back([&] {
+                    for (int p = 0; p < phases; ++p) {
+                        arrived.fetch_add(1);
+                        b.arrive_and_wait();
+                        REQUIRE_T(completed == p + 1);
+                    }
+                });
+                for (auto& t : threads) t.join();
+
+                REQUIRE(complete);
+                REQUIRE(phases == completed);
+            }
+        }
+    }
+
+    SECTION("dropping out") {
+        constexpr auto count = 6;
+        constexpr auto phases = 50;
+        for (const auto arrival : strategies) {
+            std::atomic_int arrived = { 0 };
+            int expected = count;
+            int completed = 0;
+            bool complete = true;
+            std::atomic_int dropping = { 0 };
+            jjc::barrier b { count, arrival, [&]() noexcept {
+                complete = complete && arrived.exchange(0) == expected;
+                expected -= dropping.exchange(0);
+                ++completed;
+            } };
+
+            // thread i drops out after phase i
+            auto threads = std::vector<std::thread>();
+            for (int i = 0; i < count; ++i) threads.emplace_back([&, i] {
+                for (int p = 0; p < phases; ++p) {
+                    arrived.fetch_add(1);
+                    if (p == i && i != 0) {
+                        dropping.fetch_add(1);
+                        b.arrive_and_drop();
+                        return;
+                    }
+                    b.arrive_and_wait();
+                }
+            });
+            for (auto& t : threads) t.join();
+
+            REQUIRE(complete);
+            REQUIRE(phases == completed);
+        }
+    }
+}
@@ -3,11 +3,14 @@
 
 #include <array>
 #include "assert_thread.hpp"
+#include <atomic>
 #include "channel_test_help.hpp"
 #include <future>
+#include <iterator>
 #include <jjc/latch.hpp>
 #include <memory>
 #include <thread>
+#include <vector>
 
 TEST_CASE("bounded channel type agnostic", "[mpsc]") {
     SECTION("one sender disconnect") {
@@ -29,6 +32,23 @@ TEST_CASE("bounded channel type agnostic", "[mpsc]") {
 
         REQUIRE(jjc::mpsc::status::CLOSED == send.send(42));
     }
+
+    SECTION("a send whose move throws leaves its slot empty") {
+        auto [send, recv] = jjc::mpsc::channel<throws_on_move>(3);
+
+        throws_on_move::fail = true;
+        REQUIRE_THROWS_AS(send.send(throws_on_move(1)), std::runtime_error);
+        REQUIRE_THROWS_AS(send.try_send(throws_on_move(2)), std::runtime_error);
+        throws_on_move::fail = false;
+
+        // both empty slots are freed on the way to the item
+        REQUIRE(send.send(throws_on_move(3)));
+        const auto r = recv.try_receive();
+        REQUIRE(jjc::mpsc::status::OK == r.result);
+        REQUIRE(3 == r->value);
+        REQUIRE(send.try_send(throws_on_move(4)));
+        REQUIRE(send.try_send(throws_on_move(5)));
+    }
 }
 
 TEMPLATE_TEST_CASE("bounded channel", "[mpsc]", int, std::unique_ptr<int>) {
@@ -76,6 +96,150 @@ TEMPLATE_TEST_CASE("bounded channel", "[mpsc]", int, std::unique_ptr<int>) {
         REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
     }
 
+    SECTION("receive many") {
+        auto [send, recv] = jjc::mpsc::channel<TestType>(5);
+        auto out = std::vector<TestType>();
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.receive_many(std::back_inserter(out), 10).result);
+        for (auto i = 0; i < 5; ++i) REQUIRE(send.send(PUT(i)));
+
+        auto r = recv.receive_many(std::back_inserter(out), 3);
+        REQUIRE(r);
+        REQUIRE(3 == r.count);
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(r);
+        REQUIRE(2 == r.count);
+        REQUIRE(5 == out.size());
+        for (auto i = 0; i < 5; ++i) REQUIRE(i == GET(std::move(out[i])));
+
+        REQUIRE(send.send(PUT(5)));
+        {
+            auto s = std::move(send);
+        }
+        out.clear();
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(jjc::mpsc::status::CLOSED == r.result);
+        REQUIRE(1 == r.count);
+        REQUIRE(5 == GET(std::move(out[0])));
+    }
+
+    SECTION("receive batch") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = jjc::mpsc::channel<TestType>(5);
+
+        for (auto i = 0; i < 3; ++i) REQUIRE(send.send(PUT(i)));
+        auto batch = recv.receive_batch(2, 1ms);
+        REQUIRE(jjc::mpsc::status::OK == batch.result);
+        REQUIRE(2 == batch.size());
+        REQUIRE(0 == GET(std::move(batch[0])));
+        REQUIRE(1 == GET(std::move(batch[1])));
+
+        // lingers for more, but returns what it has once the deadline passes
+        batch = recv.receive_batch(10, 1ms);
+        REQUIRE(jjc::mpsc::status::OK == batch.result);
+        REQUIRE(1 == batch.size());
+        REQUIRE(2 == GET(std::move(batch[0])));
+
+        REQUIRE(send.send(PUT(3)));
+        {
+            auto s = std::move(send);
+        }
+        batch = recv.receive_batch(10, 1ms);
+        REQUIRE(jjc::mpsc::status::CLOSED == batch.result);
+        REQUIRE(1 == batch.size());
+        REQUIRE(3 == GET(std::move(batch[0])));
+    }
+
+    SECTION("send many") {
+        auto [send, recv] = jjc::mpsc::channel<TestType>(3);
+        auto items = std::vector<TestType>();
+        for (auto i = 0; i < 5; ++i) items.push_back(PUT(i));
+        auto first = std::make_move_iterator(items.begin());
+        const auto last = std::make_move_iterator(items.end());
+
+        auto r = send.try_send_many(first, last);
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == r.result);
+        REQUIRE(3 == r.count);
+        std::advance(first, r.count);
+        REQUIRE(0 == GET(recv.receive().value()));
+
+        r = send.try_send_many(first, last);
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == r.result);
+        REQUIRE(1 == r.count);
+        std::advance(first, r.count);
+
+        // blocks until the receiver makes room
+        auto t = std::async(std::launch::async, [&] {
+            for (auto i = 1; i < 5; ++i) REQUIRE_T(i == GET(recv.receive().value()));
+        });
+        r = send.send_many(first, last);
+        REQUIRE(r);
+        REQUIRE(1 == r.count);
+        t.get();
+
+        // larger than the capacity, so it has to be split up
+        items.clear();
+        for (auto i = 0; i < 10; ++i) items.push_back(PUT(i));
+        t = std::async(std::launch::async, [&] {
+            for (auto i = 0; i < 10; ++i) REQUIRE_T(i == GET(recv.receive().value()));
+        });
+        r = send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        REQUIRE(r);
+        REQUIRE(10 == r.count);
+        t.get();
+    }
+
+    SECTION("wraps around") {
+        using namespace std::chrono_literals;
+        auto check = [](auto chs) {
+            auto& [send, recv] = chs;
+            for (auto lap = 0; lap < 5; ++lap) {
+                for (auto i = 0; i < 3; ++i) REQUIRE(send.try_send(PUT(i)));
+                REQUIRE(jjc::mpsc::status::WOULD_BLOCK == send.try_send(PUT(3)));
+                REQUIRE(jjc::mpsc::status::TIMEOUT == send.try_send_for(PUT(3), 1ms));
+                // leave one behind so the next lap starts part way around
+                for (auto i = 0; i < 2; ++i) REQUIRE(i == GET(recv.receive().value()));
+                REQUIRE(2 == GET(recv.receive().value()));
+            }
+            REQUIRE(jjc::mpsc::status::TIMEOUT == recv.try_receive_for(1ms).result);
+        };
+        check(jjc::mpsc::channel<TestType>(3));
+        check(jjc::mpsc::channel<TestType, 3>());
+    }
+
+    SECTION("compile time capacity") {
+        auto [send, recv] = jjc::mpsc::channel<TestType, 4>();
+
+        REQUIRE(jjc::mpsc::blocking::SOMETIMES == send.blocks());
+        for (auto i = 0; i < 4; ++i) REQUIRE(send.try_send(PUT(i)));
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == send.try_send(PUT(4)));
+
+        auto t = std::async(std::launch::async, [&] {
+            for (auto i = 0; i < 10; ++i) REQUIRE_T(i == GET(recv.receive().value()));
+        });
+        for (auto i = 4; i < 10; ++i) REQUIRE(send.send(PUT(i)));
+        t.get();
+
+        {
+            auto s = std::move(send);
+        }
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+    }
+
+    SECTION("close unblocks senders") {
+        auto [send, recv] = jjc::mpsc::channel<TestType>(1);
+        REQUIRE(send.send(PUT(0)));
+
+        auto t = std::async(std::launch::async, [&send] {
+            REQUIRE_T(jjc::mpsc::status::CLOSED == send.send(PUT(1)));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        {
+            auto r = std::move(recv);
+        }
+        t.get();
+    }
+
     SECTION("one sender") {
         static constexpr auto before_recv_count = 5;
         static constexpr auto during_recv_count = 10;
@@ -126,4 +290,35 @@ TEMPLATE_TEST_CASE("bounded channel", "[mpsc]", int, std::unique_ptr<int>) {
         REQUIRE(count * senders == total);
         for (auto& t : threads) t.join();
     }
+    SECTION("senders that time out don't strand blocked ones") {
+        using namespace std::chrono_literals;
+        static constexpr auto count = 200;
+        static constexpr auto senders = 3;
+        auto [send, recv] = jjc::mpsc::channel<TestType>(1);
+        std::atomic_bool done = false;
+
+        // Each slot wakes a single sender, which is often one that is about
+        // to time out
+        std::array<std::thread, senders> impatient {};
+        for (auto& t : impatient) t = std::thread([send = send, &done]() mutable {
+            while (!done) send.try_send_for(PUT(-1), 50us);
+        });
+        std::array<std::thread, senders> blocked {};
+        for (auto& t : blocked) t = std::thread([send = send]() mutable {
+            for (auto i = 0; i < count; ++i) REQUIRE_T(send.send(PUT(i)));
+        });
+        {
+            auto s = std::move(send);
+        }
+
+        auto received = 0;
+        while (received < count * senders) {
+            if (GET(recv.receive().value()) != -1) ++received;
+        }
+        for (auto& t : blocked) t.join();
+        done = true;
+        while (recv.try_receive_for(1ms)) {}
+        for (auto& t : impatient) t.join();
+        REQUIRE(count * senders == received);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <jjc/broadcast.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+auto skipping(std::ptrdiff_t capacity) {
+    auto opts = jjc::broadcast::options{};
+    opts.on_lag = jjc::broadcast::lag_policy::SKIP;
+    return jjc::broadcast::channel<int>(capacity, opts);
+}
+
+}
+
+TEST_CASE("broadcast channel", "[broadcast]") {
+    SECTION("every receiver gets every item") {
+        auto [send, recv] = jjc::broadcast::channel<std::string>(4);
+        auto copy = recv;
+
+        REQUIRE(send.send("a"));
+        REQUIRE(send.send(std::string("b")));
+
+        for (auto* r : { &recv, &copy }) {
+            REQUIRE("a" == *r->receive().value());
+            auto v = r->receive();
+            REQUIRE(v);
+            REQUIRE(1 == v.value()->size());
+            REQUIRE(jjc::broadcast::status::WOULD_BLOCK == r->try_receive().result);
+        }
+    }
+
+    SECTION("copies start where the original is") {
+        auto [send, recv] = jjc::broadcast::channel<int>(4);
+        REQUIRE(send.send(1));
+        REQUIRE(send.send(2));
+        REQUIRE(1 == *recv.receive().value());
+
+        auto copy = recv;
+        REQUIRE(2 == *copy.receive().value());
+        REQUIRE(2 == *recv.receive().value());
+    }
+
+    SECTION("the slowest receiver holds up the sender") {
+        auto [send, recv] = jjc::broadcast::channel<int>(2);
+        auto slow = recv;
+        REQUIRE(jjc::broadcast::blocking::SOMETIMES == send.blocks());
+
+        REQUIRE(send.try_send(1));
+        REQUIRE(send.try_send(2));
+        REQUIRE(1 == *recv.receive().value());
+        REQUIRE(2 == *recv.receive().value());
+        REQUIRE(jjc::broadcast::status::WOULD_BLOCK == send.try_send(3).result);
+        REQUIRE(jjc::broadcast::status::TIMEOUT == send.try_send_for(3, std::chrono::milliseconds(1)).result);
+
+        REQUIRE(1 == *slow.receive().value());
+        REQUIRE(send.try_send(3));
+        REQUIRE(3 == *recv.receive().value());
+    }
+
+    SECTION("a lagging receiver skips ahead") {
+        auto [send, recv] = skipping(2);
+        auto fast = recv;
+        REQUIRE(jjc::broadcast::blocking::NEVER == send.blocks());
+
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(send.try_send(i));
+            REQUIRE(i == *fast.receive().value());
+        }
+
+        const auto lagged = recv.receive();
+        REQUIRE(jjc::broadcast::status::LAGGED == lagged.result);
+        REQUIRE(!lagged);
+        REQUIRE(3 == lagged.skipped);
+        REQUIRE(3 == *recv.receive().value());
+        REQUIRE(4 == *recv.receive().value());
+        REQUIRE(jjc::broadcast::status::WOULD_BLOCK == recv.try_receive().result);
+    }
+
+    SECTION("views outlive the item being replaced") {
+        auto [send, recv] = skipping(1);
+        REQUIRE(send.send(1));
+        auto v = recv.receive().value();
+        REQUIRE(send.try_send(2));
+        REQUIRE(send.try_send(3));
+
+        REQUIRE(1 == *v);
+        REQUIRE(1 == recv.receive().skipped);
+        REQUIRE(3 == *recv.receive().value());
+    }
+
+    SECTION("sender disconnect") {
+        auto [send, recv] = jjc::broadcast::channel<int>(2);
+        auto copy = recv;
+        REQUIRE(send.send(1));
+        {
+            auto s = std::move(send);
+        }
+
+        REQUIRE(1 == *recv.receive().value());
+        REQUIRE(jjc::broadcast::status::CLOSED == recv.receive().result);
+        REQUIRE(1 == *copy.try_receive().value());
+        REQUIRE(jjc::broadcast::status::CLOSED == copy.try_receive().result);
+    }
+
+    SECTION("every receiver closes") {
+        auto [send, recv] = jjc::broadcast::channel<int>(1);
+        {
+            auto r = std::move(recv);
+            REQUIRE(send.send(1));
+        }
+        REQUIRE(jjc::broadcast::status::CLOSED == send.send(2).result);
+    }
+
+    SECTION("closing wakes a blocked sender") {
+        auto [send, recv] = jjc::broadcast::channel<int>(1);
+        REQUIRE(send.send(1));
+
+        auto sender = std::thread([&send = send] {
+            REQUIRE_T(jjc::broadcast::status::CLOSED == send.send(2).result);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        {
+            auto r = std::move(recv);
+        }
+        sender.join();
+    }
+
+    SECTION("receive timeout") {
+        auto [send, recv] = jjc::broadcast::channel<int>(1);
+        REQUIRE(jjc::broadcast::status::TIMEOUT == recv.try_receive_for(std::chrono::milliseconds(1)).result);
+        REQUIRE(jjc::broadcast::status::TIMEOUT == recv.try_receive_until(std::chrono::system_clock::now()).result);
+    }
+
+    SECTION("invalid capacity") {
+        REQUIRE_THROWS_AS(jjc::broadcast::channel<int>(0), jjc::broadcast::invalid_capacity);
+        REQUIRE_THROWS_AS(jjc::broadcast::channel<int>(-1), jjc::broadcast::invalid_capacity);
+    }
+}
+
+TEST_CASE("broadcast channel fan out", "[broadcast]") {
+    constexpr int count = 10000;
+    constexpr int receivers = 4;
+
+    auto [send, recv] = jjc::broadcast::channel<std::unique_ptr<int>>(8);
+    auto totals = std::vector<long long>(receivers);
+    auto threads = std::vector<std::thread>();
+
+    for (int i = 0; i < receivers; ++i) {
+        threads.emplace_back([r = recv, &total = totals[i]]() mutable {
+            int expected = 0;
+            for (auto v = r.receive(); v; v = r.receive()) {
+                REQUIRE_T(expected++ == **v.value());
+                total += **v.value();
+            }
+        });
+    }
+    {
+        auto r = std::move(recv);
+    }
+
+    auto sender = std::thread([s = std::move(send)]() mutable {
+        for (int i = 0; i < count; ++i) REQUIRE_T(s.send(std::make_unique<int>(i)));
+    });
+
+    sender.join();
+    for (auto& t : threads) t.join();
+    for (const auto total : totals) REQUIRE(total == (long long)count * (count - 1) / 2);
+}
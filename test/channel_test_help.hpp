@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <stdexcept>
 
 template<typename T>
 auto put(int) -> T;
@@ -24,4 +25,19 @@ inline auto get(int&& v) -> int { return v; }
 template<>
 inline auto get(std::unique_ptr<int>&& v) -> int { return *v; }
 
-#define GET(v) get<TestType>(v)
\ No newline at end of file
+#define GET(v) get<TestType>(v)
+
+// An item whose move throws while `fail` is set, for checking that a slot
+// claimed for an item that never arrives doesn't wedge the channel
+struct throws_on_move {
+    inline static bool fail = false;
+    int value;
+
+    explicit throws_on_move(int v) : value(v) {}
+
+    throws_on_move(throws_on_move&& other) : value(other.value) {
+        if (fail) throw std::runtime_error("throws_on_move");
+    }
+
+    throws_on_move& operator=(throws_on_move&&) = default;
+};
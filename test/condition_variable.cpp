@@ -0,0 +1,104 @@
+#include <jjc/condition_variable.hpp>
+#include <catch2/catch.hpp>
+
+#include <array>
+#include "assert_thread.hpp"
+#include <deque>
+#include <mutex>
+#include <thread>
+
+TEST_CASE("condition_variable", "[primitive]") {
+    using namespace std::chrono_literals;
+
+    jjc::mutex m = {};
+    jjc::condition_variable cv = {};
+
+    SECTION("timed waits") {
+        auto lk = std::unique_lock(m);
+        REQUIRE(std::cv_status::timeout == cv.wait_for(lk, 1ms));
+        REQUIRE(lk.owns_lock());
+        REQUIRE(std::cv_status::timeout == cv.wait_until(lk, std::chrono::system_clock::now() + 1ms));
+        REQUIRE(!cv.wait_for(lk, 100us, [] { return false; }));
+        REQUIRE(cv.wait_for(lk, 1ms, [] { return true; }));
+    }
+
+    SECTION("notify_one wakes a waiter") {
+        bool ready = false;
+        auto t = std::thread([&] {
+            auto lk = std::unique_lock(m);
+            cv.wait(lk, [&] { return ready; });
+            REQUIRE_T(lk.owns_lock());
+        });
+        std::this_thread::sleep_for(1ms);
+        {
+            const auto lk = std::scoped_lock(m);
+            ready = true;
+        }
+        cv.notify_one();
+        t.join();
+    }
+
+    SECTION("notify_all wakes every waiter") {
+        // once with the mutex held by the notifier and once without
+        for (const auto held : { true, false }) {
+            int generation = 0;
+            int woken = 0;
+            std::array<std::thread, 6> threads {};
+            for (auto& t : threads) t = std::thread([&] {
+                auto lk = std::unique_lock(m);
+                const auto mine = generation;
+                REQUIRE_T(cv.wait_for(lk, 10s, [&] { return generation != mine; }));
+                ++woken;
+            });
+            std::this_thread::sleep_for(10ms);
+
+            auto lk = std::unique_lock(m);
+            ++generation;
+            if (!held) lk.unlock();
+            cv.notify_all();
+            if (held) lk.unlock();
+            for (auto& t : threads) t.join();
+
+            REQUIRE(threads.size() == static_cast<std::size_t>(woken));
+        }
+    }
+
+    SECTION("producers and consumers") {
+        constexpr auto per_producer = 2000;
+        std::deque<int> queue = {};
+        int consumed = 0;
+        bool done = false;
+
+        std::array<std::thread, 3> consumers {};
+        for (auto& t : consumers) t = std::thread([&] {
+            auto lk = std::unique_lock(m);
+            while (true) {
+                cv.wait(lk, [&] { return done || !queue.empty(); });
+                if (queue.empty()) return;
+                queue.pop_front();
+                ++consumed;
+            }
+        });
+
+        std::array<std::thread, 2> producers {};
+        for (auto& t : producers) t = std::thread([&] {
+            for (int i = 0; i < per_producer; ++i) {
+                {
+                    const auto lk = std::scoped_lock(m);
+                    queue.push_back(i);
+                }
+                if (i % 2 == 0) cv.notify_one();
+                else cv.notify_all();
+            }
+        });
+        for (auto& t : producers) t.join();
+        {
+            const auto lk = std::scoped_lock(m);
+            done = true;
+        }
+        cv.notify_all();
+        for (auto& t : consumers) t.join();
+
+        REQUIRE(static_cast<int>(producers.size()) * per_producer == consumed);
+    }
+}
@@ -18,6 +18,28 @@ TEST_CASE("event", "[primitive]") {
         REQUIRE(e.wait_until(std::chrono::steady_clock::now() + 1ms));
     }
 
+    SECTION("sub-millisecond timeouts") {
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(!e.wait_for(300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 300us);
+        REQUIRE(!e.wait_until(std::chrono::system_clock::now() + 300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 600us);
+    }
+
+    SECTION("timed wait gives up while parked") {
+        // a deadline far enough away that the waiter parks before it passes
+        REQUIRE(!e.wait_for(5ms));
+    }
+
+    SECTION("timed wait is woken by signal") {
+        auto t = std::thread([&] {
+            std::this_thread::sleep_for(5ms);
+            e.signal();
+        });
+        REQUIRE(e.wait_for(10s));
+        t.join();
+    }
+
     SECTION("multiple waiters") {
         constexpr auto total = 5;
         jjc::latch l { total + 1 };
@@ -70,4 +92,24 @@ TEST_CASE("event", "[primitive]") {
         for (auto& t : threads) t.join();
         REQUIRE(num_threads == stages[num_stages - 1].count);
     }
+
+    SECTION("ping pong") {
+        // Each side alternates between parking and signaling, so a signal that
+        // skips the wake for a waiter that is about to park would hang here.
+        constexpr auto rounds = 10000;
+        jjc::event other { false };
+
+        auto t = std::thread([&] {
+            for (auto i = 0; i < rounds; ++i) {
+                e.wait();
+                other.signal();
+            }
+        });
+
+        for (auto i = 0; i < rounds; ++i) {
+            e.signal();
+            other.wait();
+        }
+        t.join();
+    }
 }
\ No newline at end of file
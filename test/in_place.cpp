@@ -0,0 +1,125 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+#include <future>
+#include <memory>
+#include <string>
+
+namespace {
+
+// Counts how often it is copied or moved
+struct tracked {
+    static inline int copies = 0;
+    static inline int moves = 0;
+
+    tracked() = default;
+    tracked(int a, std::string b) : a(a), b(std::move(b)) {}
+    tracked(const tracked& o) : a(o.a), b(o.b) { ++copies; }
+    tracked(tracked&& o) noexcept : a(o.a), b(std::move(o.b)) { ++moves; }
+    tracked& operator=(const tracked& o) { a = o.a; b = o.b; ++copies; return *this; }
+    tracked& operator=(tracked&& o) noexcept { a = o.a; b = std::move(o.b); ++moves; return *this; }
+
+    static void reset() { copies = moves = 0; }
+
+    int a = 0;
+    std::string b;
+};
+
+template<typename Channel>
+void check_in_place(Channel&& ch) {
+    auto& [send, recv] = ch;
+    tracked::reset();
+
+    REQUIRE(send.emplace(1, "one"));
+    const auto two = tracked(2, "two");
+    REQUIRE(send.send(two));
+    REQUIRE(send.emplace(3, "three"));
+    REQUIRE(0 == tracked::moves);
+    REQUIRE(1 == tracked::copies);
+
+    REQUIRE(jjc::mpsc::status::OK == recv.receive([](tracked& v) {
+        REQUIRE(1 == v.a);
+        REQUIRE("one" == v.b);
+    }));
+    REQUIRE(jjc::mpsc::status::OK == recv.receive([](const tracked& v) { REQUIRE(2 == v.a); }));
+    REQUIRE(0 == tracked::moves);
+
+    auto out = tracked();
+    REQUIRE(jjc::mpsc::status::OK == recv.receive_into(out));
+    REQUIRE(3 == out.a);
+    REQUIRE("three" == out.b);
+    REQUIRE(1 == tracked::moves);
+    REQUIRE(1 == tracked::copies);
+
+    {
+        auto s = std::move(send);
+    }
+    REQUIRE(jjc::mpsc::status::CLOSED == recv.receive_into(out));
+    REQUIRE(jjc::mpsc::status::CLOSED == recv.receive([](tracked&) { FAIL("no item"); }));
+    REQUIRE(3 == out.a);
+}
+
+}
+
+TEST_CASE("emplace and receive in place", "[mpsc]") {
+    auto opts = jjc::mpsc::options{};
+
+    SECTION("unbounded") {
+        check_in_place(jjc::mpsc::channel<tracked>(jjc::mpsc::unbounded, opts));
+    }
+
+    SECTION("segmented") {
+        opts.segment_size = 2;
+        check_in_place(jjc::mpsc::channel<tracked>(jjc::mpsc::unbounded, opts));
+    }
+
+    SECTION("lanes") {
+        opts.per_sender_lanes = true;
+        check_in_place(jjc::mpsc::channel<tracked>(jjc::mpsc::unbounded, opts));
+    }
+
+    SECTION("bounded") {
+        check_in_place(jjc::mpsc::channel<tracked>(3, opts));
+        check_in_place(jjc::mpsc::channel<tracked, 4>(opts));
+    }
+
+    SECTION("static kinds") {
+        check_in_place(jjc::mpsc::channel<tracked, jjc::mpsc::kind::unbounded>(opts));
+        check_in_place(jjc::mpsc::channel<tracked, jjc::mpsc::kind::segmented>(opts));
+        check_in_place(jjc::mpsc::channel<tracked, jjc::mpsc::kind::bounded>(3, opts));
+    }
+
+    SECTION("spsc") {
+        check_in_place(jjc::spsc::channel<tracked>(jjc::spsc::unbounded, opts));
+        check_in_place(jjc::spsc::channel<tracked>(3, opts));
+    }
+
+    SECTION("mpmc") {
+        check_in_place(jjc::mpmc::channel<tracked>(jjc::mpmc::unbounded, opts));
+        check_in_place(jjc::mpmc::channel<tracked>(3, opts));
+    }
+}
+
+TEST_CASE("receive in place waits for an item", "[mpsc]") {
+    using namespace std::chrono_literals;
+
+    for (const std::ptrdiff_t capacity : { jjc::mpsc::unbounded, std::ptrdiff_t(0), std::ptrdiff_t(1) }) {
+        auto [send, recv] = jjc::mpsc::channel<std::unique_ptr<int>>(capacity);
+        auto t = std::async(std::launch::async, [send = std::move(send)]() mutable {
+            std::this_thread::sleep_for(10ms);
+            REQUIRE_T(send.emplace(new int(42)));
+            REQUIRE_T(send.emplace(new int(43)));
+        });
+
+        int got = 0;
+        REQUIRE(jjc::mpsc::status::OK == recv.receive([&got](std::unique_ptr<int>& v) { got = *v; }));
+        REQUIRE(42 == got);
+
+        auto out = std::unique_ptr<int>();
+        REQUIRE(jjc::mpsc::status::OK == recv.receive_into(out));
+        REQUIRE(43 == *out);
+        t.get();
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive_into(out));
+    }
+}
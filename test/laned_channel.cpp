@@ -0,0 +1,181 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include <array>
+#include "channel_test_help.hpp"
+#include <iterator>
+#include <jjc/latch.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template<typename T>
+auto laned(std::size_t segment_size = 0) {
+    auto opts = jjc::mpsc::options{};
+    opts.per_sender_lanes = true;
+    opts.segment_size = segment_size;
+    return jjc::mpsc::channel<T>(jjc::mpsc::unbounded, opts);
+}
+
+}
+
+TEST_CASE("laned channel type agnostic", "[mpsc]") {
+    SECTION("one sender disconnect") {
+        auto [send, recv] = laned<int>();
+
+        {
+            auto s = std::move(send);
+        }
+
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.try_receive().result);
+    }
+
+    SECTION("receiver closes") {
+        auto [send, recv] = laned<int>();
+        auto copy = send;
+
+        {
+            auto r = std::move(recv);
+        }
+
+        REQUIRE(jjc::mpsc::status::CLOSED == send.send(42));
+        REQUIRE(jjc::mpsc::status::CLOSED == copy.send(42));
+    }
+
+    SECTION("assignment disconnects the old lane") {
+        auto [send, recv] = laned<int>();
+
+        {
+            auto s1 = std::move(send);
+            auto s2 = s1;
+            REQUIRE(s2.send(1));
+            s2 = s1;
+            REQUIRE(s2.send(2));
+            s1 = std::move(s2);
+            REQUIRE(s1.send(3));
+        }
+
+        auto items = std::vector<int>();
+        for (auto& v : recv) items.push_back(v);
+        REQUIRE(3 == items.size());
+    }
+}
+
+TEMPLATE_TEST_CASE("laned channel", "[mpsc]", int, std::unique_ptr<int>) {
+    SECTION("basic invariants") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = laned<TestType>();
+
+        REQUIRE(jjc::mpsc::blocking::NEVER == send.blocks());
+        REQUIRE(jjc::mpsc::blocking::SOMETIMES == recv.blocks());
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+        REQUIRE(jjc::mpsc::status::TIMEOUT == recv.try_receive_for(1ms).result);
+        REQUIRE(send.send(PUT(42)));
+        REQUIRE(42 == GET(recv.receive().value()));
+        REQUIRE(send.try_send(PUT(42)));
+        REQUIRE(42 == GET(recv.try_receive().value()));
+        REQUIRE(send.try_send_for(PUT(42), 1ms));
+        REQUIRE(42 == GET(recv.try_receive_for(1ms).value()));
+        REQUIRE(send.try_send_until(PUT(42), std::chrono::steady_clock::now() + 1ms));
+        REQUIRE(42 == GET(recv.try_receive_until(std::chrono::steady_clock::now() + 1ms).value()));
+    }
+
+    SECTION("lanes take turns") {
+        auto [send, recv] = laned<TestType>(2);
+
+        {
+            auto s1 = std::move(send);
+            auto s2 = s1;
+
+            for (auto i = 0; i < 5; ++i) REQUIRE(s1.send(PUT(i)));
+            for (auto i = 0; i < 5; ++i) REQUIRE(s2.send(PUT(100 + i)));
+
+            // neither lane is drained before the other gets a turn
+            const auto a = GET(recv.receive().value());
+            const auto b = GET(recv.receive().value());
+            REQUIRE((a < 100) != (b < 100));
+        }
+
+        auto next = std::array<int, 2>{ 1, 101 };
+        for (auto& v : recv) {
+            const auto i = GET(std::move(v));
+            auto& expected = next[i < 100 ? 0 : 1];
+            REQUIRE(expected++ == i);
+        }
+        REQUIRE(5 == next[0]);
+        REQUIRE(105 == next[1]);
+    }
+
+    SECTION("receive many") {
+        auto [send, recv] = laned<TestType>(4);
+        auto out = std::vector<TestType>();
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.receive_many(std::back_inserter(out), 10).result);
+        {
+            auto copy = send;
+            for (auto i = 0; i < 10; ++i) REQUIRE(send.send(PUT(i)));
+            for (auto i = 0; i < 10; ++i) REQUIRE(copy.send(PUT(i)));
+        }
+
+        auto r = recv.receive_many(std::back_inserter(out), 3);
+        REQUIRE(r);
+        REQUIRE(3 == r.count);
+        r = recv.receive_many(std::back_inserter(out), 30);
+        REQUIRE(r);
+        REQUIRE(17 == r.count);
+
+        {
+            auto s = std::move(send);
+        }
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(jjc::mpsc::status::CLOSED == r.result);
+        REQUIRE(0 == r.count);
+    }
+
+    SECTION("send many") {
+        auto [send, recv] = laned<TestType>(8);
+        auto items = std::vector<TestType>();
+        for (auto i = 0; i < 50; ++i) items.push_back(PUT(i));
+
+        auto r = send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        REQUIRE(r);
+        REQUIRE(50 == r.count);
+        for (auto i = 0; i < 50; ++i) REQUIRE(i == GET(recv.receive().value()));
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+    }
+
+    SECTION("multiple senders") {
+        auto [send, recv] = laned<TestType>(4);
+        static constexpr auto count = 100;
+        static constexpr auto senders = 5;
+        jjc::latch latch { senders + 1 };
+
+        std::array<std::thread, senders> threads {};
+        {
+            auto s = std::move(send);
+            for (auto j = 0; j < senders; ++j) threads[j] = std::thread([send = s, &latch, j]() mutable {
+                latch.arrive_and_wait();
+                for (auto i = 0; i < count; ++i) {
+                    send.send(PUT(j * count + i));
+                }
+            });
+        }
+
+        // each sender's items still arrive in order
+        auto next = std::array<int, senders>{};
+        auto total = 0;
+        latch.arrive_and_wait();
+        for (auto& v : recv) {
+            const auto i = GET(std::move(v));
+            REQUIRE(next[i / count]++ == i % count);
+            ++total;
+        }
+
+        REQUIRE(count * senders == total);
+        for (auto& t : threads) t.join();
+    }
+}
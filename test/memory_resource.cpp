@@ -0,0 +1,144 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+#include <atomic>
+#include <cstddef>
+#include <jjc/broadcast.hpp>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Counts what passes through to the default resource
+struct counting_resource : std::pmr::memory_resource {
+    std::atomic_size_t allocations = { 0 };
+    std::atomic_ptrdiff_t outstanding = { 0 };
+    std::atomic_ptrdiff_t live = { 0 };
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        live.fetch_add(1, std::memory_order_relaxed);
+        outstanding.fetch_add(static_cast<std::ptrdiff_t>(bytes), std::memory_order_relaxed);
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        outstanding.fetch_sub(static_cast<std::ptrdiff_t>(bytes), std::memory_order_relaxed);
+        live.fetch_sub(1, std::memory_order_relaxed);
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+template<typename Channel>
+void exchange(Channel& send_recv, int n) {
+    auto& [send, recv] = send_recv;
+    auto t = std::thread([&send = send, n] {
+        for (int i = 0; i < n; ++i) REQUIRE_T(send.send(std::make_unique<int>(i)));
+    });
+    for (int i = 0; i < n; ++i) REQUIRE(i == *recv.receive().value());
+    t.join();
+}
+
+}
+
+TEST_CASE("channels allocate from the given resource", "[mpsc]") {
+    auto resource = counting_resource{};
+    auto opts = jjc::mpsc::options{};
+    opts.resource = &resource;
+
+    SECTION("mpsc") {
+        for (const std::ptrdiff_t capacity : { jjc::mpsc::unbounded, std::ptrdiff_t(0), std::ptrdiff_t(1), std::ptrdiff_t(8) }) {
+            for (const bool lanes : { false, true }) {
+                for (const std::size_t segment_size : { 0, 4 }) {
+                    opts.segment_size = segment_size;
+                    opts.per_sender_lanes = lanes;
+                    const auto before = resource.allocations.load();
+                    auto ch = jjc::mpsc::channel<std::unique_ptr<int>>(capacity, opts);
+                    REQUIRE(resource.allocations > before);
+                    exchange(ch, 100);
+                }
+            }
+        }
+    }
+
+    SECTION("fixed capacity") {
+        auto ch = jjc::mpsc::channel<std::unique_ptr<int>, 4>(opts);
+        REQUIRE(resource.allocations == 1);
+        exchange(ch, 100);
+    }
+
+    SECTION("node pool stays under the high water mark") {
+        opts.pool_high_water = 8;
+        auto [send, recv] = jjc::mpsc::channel<int>(jjc::mpsc::unbounded, opts);
+        // the channel and the node the receiver always holds
+        const auto base = resource.live.load();
+        for (int burst = 0; burst < 3; ++burst) {
+            for (int i = 0; i < 100; ++i) REQUIRE(send.send(i));
+            for (int i = 0; i < 100; ++i) REQUIRE(i == recv.receive().value());
+            REQUIRE(resource.live - base <= 8);
+        }
+    }
+
+    SECTION("static kinds") {
+        {
+            auto ch = jjc::mpsc::channel<std::unique_ptr<int>, jjc::mpsc::kind::unbounded>(opts);
+            exchange(ch, 100);
+        }
+        {
+            auto ch = jjc::mpsc::channel<std::unique_ptr<int>, jjc::mpsc::kind::segmented>(opts);
+            exchange(ch, 100);
+        }
+        {
+            auto ch = jjc::mpsc::channel<std::unique_ptr<int>, jjc::mpsc::kind::bounded>(4, opts);
+            exchange(ch, 100);
+        }
+        REQUIRE(resource.allocations >= 3);
+    }
+
+    SECTION("spsc") {
+        opts.segment_size = 4;
+        for (const std::ptrdiff_t capacity : { jjc::spsc::unbounded, std::ptrdiff_t(4) }) {
+            const auto before = resource.allocations.load();
+            auto ch = jjc::spsc::channel<std::unique_ptr<int>>(capacity, opts);
+            exchange(ch, 100);
+            REQUIRE(resource.allocations > before + 1);
+        }
+    }
+
+    SECTION("mpmc") {
+        opts.segment_size = 4;
+        for (const std::ptrdiff_t capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(4) }) {
+            const auto before = resource.allocations.load();
+            auto ch = jjc::mpmc::channel<std::unique_ptr<int>>(capacity, opts);
+            exchange(ch, 100);
+            REQUIRE(resource.allocations > before + 1);
+        }
+    }
+
+    SECTION("broadcast") {
+        auto bopts = jjc::broadcast::options{};
+        bopts.resource = &resource;
+        for (const auto policy : { jjc::broadcast::lag_policy::BLOCK, jjc::broadcast::lag_policy::SKIP }) {
+            bopts.on_lag = policy;
+            auto [send, recv] = jjc::broadcast::channel<int>(4, bopts);
+            const auto before = resource.allocations.load();
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(send.send(i));
+                REQUIRE(i == **recv.receive());
+            }
+            // one allocation per item, shared by every receiver's view
+            REQUIRE(resource.allocations == before + 100);
+        }
+    }
+
+    REQUIRE(0 == resource.outstanding);
+}
@@ -0,0 +1,230 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include "assert_thread.hpp"
+#include "channel_test_help.hpp"
+#include <chrono>
+#include <iterator>
+#include <jjc/latch.hpp>
+#include <jjc/select.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template<typename T>
+auto segmented(std::size_t segment_size) {
+    auto opts = jjc::mpmc::options{};
+    opts.segment_size = segment_size;
+    return jjc::mpmc::channel<T>(jjc::mpmc::unbounded, opts);
+}
+
+}
+
+TEST_CASE("mpmc channel type agnostic", "[mpmc]") {
+    SECTION("sender disconnect") {
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(1) }) {
+            auto [send, recv] = jjc::mpmc::channel<int>(capacity);
+            auto copy = recv;
+
+            {
+                auto s = std::move(send);
+            }
+
+            REQUIRE(jjc::mpmc::status::CLOSED == recv.receive().result);
+            REQUIRE(jjc::mpmc::status::CLOSED == copy.try_receive().result);
+        }
+    }
+
+    SECTION("every receiver closes") {
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(1) }) {
+            auto [send, recv] = jjc::mpmc::channel<int>(capacity);
+
+            {
+                auto r1 = std::move(recv);
+                auto r2 = r1;
+                {
+                    auto r3 = std::move(r1);
+                }
+                REQUIRE(send.send(42));
+                REQUIRE(42 == r2.receive().value());
+            }
+
+            REQUIRE(jjc::mpmc::status::CLOSED == send.send(42));
+        }
+    }
+
+    SECTION("a select that doesn't receive leaves the item to a blocked receiver") {
+        using namespace std::chrono_literals;
+
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(1) }) {
+            auto [send, recv] = jjc::mpmc::channel<int>(capacity);
+            auto copy = recv;
+            std::atomic_bool received = false;
+
+            // parks first, so a single wake would go to it
+            auto selecting = std::thread([&recv = recv] {
+                REQUIRE_T(0 == jjc::mpmc::select(recv));
+            });
+            std::this_thread::sleep_for(5ms);
+            auto receiving = std::thread([&copy, &received] {
+                REQUIRE_T(42 == copy.receive().value());
+                received = true;
+            });
+            std::this_thread::sleep_for(5ms);
+
+            REQUIRE(send.send(42));
+            const auto until = std::chrono::steady_clock::now() + 1s;
+            while (!received && std::chrono::steady_clock::now() < until) std::this_thread::sleep_for(1ms);
+            const bool woken = received;
+
+            // closing wakes everyone regardless
+            {
+                auto s = std::move(send);
+            }
+            selecting.join();
+            receiving.join();
+            REQUIRE(woken);
+        }
+    }
+
+    SECTION("a send whose move throws leaves its slot empty") {
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(3) }) {
+            auto [send, recv] = jjc::mpmc::channel<throws_on_move>(capacity);
+
+            throws_on_move::fail = true;
+            REQUIRE_THROWS_AS(send.send(throws_on_move(1)), std::runtime_error);
+            throws_on_move::fail = false;
+
+            REQUIRE(send.send(throws_on_move(2)));
+            const auto r = recv.try_receive();
+            REQUIRE(jjc::mpmc::status::OK == r.result);
+            REQUIRE(2 == r->value);
+        }
+    }
+
+    SECTION("invalid capacity") {
+        REQUIRE_THROWS_AS(jjc::mpmc::channel<int>(0), jjc::mpmc::invalid_capacity);
+        REQUIRE_THROWS_AS(jjc::mpmc::channel<int>(-2), jjc::mpmc::invalid_capacity);
+    }
+}
+
+TEMPLATE_TEST_CASE("mpmc channel", "[mpmc]", int, std::unique_ptr<int>) {
+    SECTION("basic invariants") {
+        using namespace std::chrono_literals;
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(1), std::ptrdiff_t(4) }) {
+            auto [send, recv] = jjc::mpmc::channel<TestType>(capacity);
+            auto other = recv;
+
+            REQUIRE((capacity == jjc::mpmc::unbounded ? jjc::mpmc::blocking::NEVER : jjc::mpmc::blocking::SOMETIMES) == send.blocks());
+            REQUIRE(jjc::mpmc::blocking::SOMETIMES == recv.blocks());
+
+            REQUIRE(jjc::mpmc::status::WOULD_BLOCK == recv.try_receive().result);
+            REQUIRE(jjc::mpmc::status::TIMEOUT == other.try_receive_for(1ms).result);
+            REQUIRE(send.send(PUT(42)));
+            REQUIRE(42 == GET(other.receive().value()));
+            REQUIRE(send.try_send(PUT(42)));
+            REQUIRE(42 == GET(recv.try_receive().value()));
+            REQUIRE(send.try_send_for(PUT(42), 1ms));
+            REQUIRE(42 == GET(other.try_receive_for(1ms).value()));
+            REQUIRE(send.try_send_until(PUT(42), std::chrono::steady_clock::now() + 1ms));
+            REQUIRE(42 == GET(recv.try_receive_until(std::chrono::steady_clock::now() + 1ms).value()));
+        }
+    }
+
+    SECTION("bounded wraps around") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = jjc::mpmc::channel<TestType>(3);
+        auto other = recv;
+
+        for (auto lap = 0; lap < 5; ++lap) {
+            for (auto i = 0; i < 3; ++i) REQUIRE(send.try_send(PUT(i)));
+            REQUIRE(jjc::mpmc::status::WOULD_BLOCK == send.try_send(PUT(3)));
+            REQUIRE(jjc::mpmc::status::TIMEOUT == send.try_send_for(PUT(3), 1ms));
+            for (auto i = 0; i < 3; ++i) REQUIRE(i == GET((i % 2 ? other : recv).receive().value()));
+        }
+    }
+
+    SECTION("segment boundaries") {
+        for (const auto size : { std::size_t(1), std::size_t(2), std::size_t(7) }) {
+            auto [send, recv] = segmented<TestType>(size);
+            auto other = recv;
+
+            for (auto burst = 0; burst < 3; ++burst) {
+                for (auto i = 0; i < 50; ++i) REQUIRE(send.send(PUT(i)));
+                for (auto i = 0; i < 50; ++i) REQUIRE(i == GET((i % 2 ? other : recv).receive().value()));
+            }
+            REQUIRE(jjc::mpmc::status::WOULD_BLOCK == recv.try_receive().result);
+        }
+    }
+
+    SECTION("send and receive many") {
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(16) }) {
+            auto [send, recv] = jjc::mpmc::channel<TestType>(capacity);
+            auto items = std::vector<TestType>();
+            for (auto i = 0; i < 10; ++i) items.push_back(PUT(i));
+
+            REQUIRE(send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())));
+
+            auto out = std::vector<TestType>();
+            auto r = recv.receive_many(std::back_inserter(out), 3);
+            REQUIRE(3 == r.count);
+            r = recv.receive_many(std::back_inserter(out), 20);
+            REQUIRE(7 == r.count);
+            for (auto i = 0; i < 10; ++i) REQUIRE(i == GET(std::move(out[i])));
+
+            {
+                auto s = std::move(send);
+            }
+            REQUIRE(jjc::mpmc::status::CLOSED == recv.receive_many(std::back_inserter(out), 10).result);
+        }
+    }
+
+    SECTION("multiple senders and receivers") {
+        static constexpr auto count = 200;
+        static constexpr auto senders = 3;
+        static constexpr auto receivers = 3;
+
+        for (const auto capacity : { jjc::mpmc::unbounded, std::ptrdiff_t(1), std::ptrdiff_t(8) }) {
+            auto [send, recv] = jjc::mpmc::channel<TestType>(capacity);
+            jjc::latch latch { senders + receivers };
+
+            std::array<std::thread, senders> producers {};
+            {
+                auto s = std::move(send);
+                for (auto j = 0; j < senders; ++j) producers[j] = std::thread([send = s, &latch, j]() mutable {
+                    latch.arrive_and_wait();
+                    for (auto i = 0; i < count; ++i) {
+                        send.send(PUT(j * count + i));
+                    }
+                });
+            }
+
+            // every item is received exactly once
+            std::array<std::vector<int>, receivers> received {};
+            std::array<std::thread, receivers> consumers {};
+            {
+                auto r = std::move(recv);
+                for (auto j = 0; j < receivers; ++j) consumers[j] = std::thread([recv = r, &latch, &out = received[j]]() mutable {
+                    latch.arrive_and_wait();
+                    for (auto& v : recv) {
+                        out.push_back(GET(std::move(v)));
+                    }
+                });
+            }
+
+            for (auto& t : producers) t.join();
+            for (auto& t : consumers) t.join();
+
+            auto seen = std::vector<int>(count * senders);
+            for (const auto& items : received) {
+                for (const auto i : items) ++seen[i];
+            }
+            REQUIRE(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+        }
+    }
+}
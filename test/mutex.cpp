@@ -39,4 +39,23 @@ TEST_CASE("mutex", "[primitive]") {
 
         REQUIRE(total == count);
     }
+
+    SECTION("contended hand-off") {
+        // Short holds are mostly caught by the spin, while the occasional
+        // long one sends the waiters on to park
+        constexpr auto total = 4;
+        constexpr auto iterations = 2000;
+
+        std::array<std::thread, total> threads {};
+        for (auto& t : threads) t = std::thread([&] {
+            for (int i = 0; i < iterations; ++i) {
+                const auto lk = std::scoped_lock(m);
+                if (i % 256 == 0) std::this_thread::sleep_for(100us);
+                ++count;
+            }
+        });
+        for (auto& t : threads) t.join();
+
+        REQUIRE(total * iterations == count);
+    }
 }
\ No newline at end of file
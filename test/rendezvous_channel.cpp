@@ -6,6 +6,8 @@
 #include "channel_test_help.hpp"
 #include <future>
 #include <memory>
+#include <thread>
+#include <vector>
 
 TEST_CASE("rendezvous channel type agnostic", "[mpsc]") {    
     auto [send, recv] = jjc::mpsc::channel<int>(0);
@@ -49,6 +51,100 @@ TEMPLATE_TEST_CASE("rendezvous channel", "[mpsc]", int, std::unique_ptr<int>) {
         REQUIRE(42 == GET(recv.receive().value()));
     }
 
+    SECTION("receive batch") {
+        using namespace std::chrono_literals;
+        auto t = std::async(std::launch::async, [send = std::move(send)]() mutable {
+            auto s = std::move(send);
+            REQUIRE_T(s.send(PUT(1)));
+            REQUIRE_T(s.send(PUT(2)));
+        });
+
+        auto received = std::vector<TestType>();
+        while (true) {
+            auto batch = recv.receive_batch(10, 1s);
+            for (auto& v : batch) received.push_back(std::move(v));
+            if (jjc::mpsc::status::CLOSED == batch.result) break;
+        }
+
+        REQUIRE(2 == received.size());
+    }
+
+    SECTION("send many") {
+        auto items = std::vector<TestType>();
+        items.push_back(PUT(1));
+        items.push_back(PUT(2));
+        auto first = std::make_move_iterator(items.begin());
+        const auto last = std::make_move_iterator(items.end());
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == send.try_send_many(first, last).result);
+
+        auto t = std::async(std::launch::async, [send = std::move(send), first, last]() mutable {
+            auto s = std::move(send);
+            REQUIRE_T(2 == s.send_many(first, last).count);
+        });
+
+        REQUIRE(1 == GET(recv.receive().value()));
+        REQUIRE(2 == GET(recv.receive().value()));
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+    }
+
+    SECTION("try_receive takes from a waiting sender") {
+        auto t = std::async(std::launch::async, [send = std::move(send)]() mutable {
+            auto s = std::move(send);
+            REQUIRE_T(s.send(PUT(42)));
+        });
+
+        auto r = recv.try_receive();
+        while (jjc::mpsc::status::WOULD_BLOCK == r.result) {
+            std::this_thread::yield();
+            r = recv.try_receive();
+        }
+        REQUIRE(42 == GET(std::move(r.value())));
+        t.get();
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.try_receive().result);
+    }
+
+    SECTION("try_send hands to a waiting receiver") {
+        auto t = std::async(std::launch::async, [recv = std::move(recv)]() mutable {
+            REQUIRE_T(42 == GET(recv.receive().value()));
+        });
+
+        auto r = send.try_send(PUT(42));
+        while (jjc::mpsc::status::WOULD_BLOCK == r.result) {
+            std::this_thread::yield();
+            r = send.try_send(std::move(r.item.value()));
+        }
+        REQUIRE(r);
+        t.get();
+        REQUIRE(jjc::mpsc::status::CLOSED == send.send(PUT(43)));
+    }
+
+    SECTION("timeouts withdraw") {
+        using namespace std::chrono_literals;
+        auto timed_out = send.try_send_for(PUT(42), 1ms);
+        REQUIRE(jjc::mpsc::status::TIMEOUT == timed_out);
+        REQUIRE(42 == GET(std::move(timed_out.item.value())));
+        REQUIRE(jjc::mpsc::status::TIMEOUT == recv.try_receive_for(1ms).result);
+
+        // neither side is left behind for the other to find
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == send.try_send(PUT(43)));
+    }
+
+    SECTION("receiver closing wakes a waiting sender") {
+        auto t = std::async(std::launch::async, [send = std::move(send)]() mutable {
+            auto failed = send.send(PUT(42));
+            REQUIRE_T(jjc::mpsc::status::CLOSED == failed);
+            REQUIRE_T(42 == GET(std::move(failed.item.value())));
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        {
+            auto r = std::move(recv);
+        }
+        t.get();
+    }
+
     SECTION("multiple senders can rendezvous") {
         auto s1 = std::move(send);
         auto s2 = s1;
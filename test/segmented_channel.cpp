@@ -0,0 +1,188 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include "channel_test_help.hpp"
+#include <future>
+#include <iterator>
+#include <jjc/latch.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template<typename T>
+auto segmented(std::size_t segment_size) {
+    auto opts = jjc::mpsc::options{};
+    opts.segment_size = segment_size;
+    return jjc::mpsc::channel<T>(jjc::mpsc::unbounded, opts);
+}
+
+}
+
+TEST_CASE("segmented channel type agnostic", "[mpsc]") {
+    SECTION("one sender disconnect") {
+        auto [send, recv] = segmented<int>(32);
+
+        {
+            auto s = std::move(send);
+        }
+
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.try_receive().result);
+    }
+
+    SECTION("receiver closes") {
+        auto [send, recv] = segmented<int>(32);
+
+        {
+            auto r = std::move(recv);
+        }
+
+        REQUIRE(jjc::mpsc::status::CLOSED == send.send(42));
+    }
+
+    SECTION("a send whose move throws leaves its slot empty") {
+        auto [send, recv] = segmented<throws_on_move>(4);
+
+        throws_on_move::fail = true;
+        REQUIRE_THROWS_AS(send.send(throws_on_move(1)), std::runtime_error);
+        throws_on_move::fail = false;
+
+        REQUIRE(send.send(throws_on_move(2)));
+        const auto r = recv.try_receive();
+        REQUIRE(jjc::mpsc::status::OK == r.result);
+        REQUIRE(2 == r->value);
+    }
+}
+
+TEMPLATE_TEST_CASE("segmented channel", "[mpsc]", int, std::unique_ptr<int>) {
+    SECTION("basic invariants") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = segmented<TestType>(32);
+
+        REQUIRE(jjc::mpsc::blocking::NEVER == send.blocks());
+        REQUIRE(jjc::mpsc::blocking::SOMETIMES == recv.blocks());
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+        REQUIRE(send.send(PUT(42)));
+        REQUIRE(42 == GET(recv.receive().value()));
+        REQUIRE(send.try_send(PUT(42)));
+        REQUIRE(42 == GET(recv.try_receive().value()));
+        REQUIRE(send.try_send_for(PUT(42), 1ms));
+        REQUIRE(42 == GET(recv.try_receive_for(1ms).value()));
+        REQUIRE(send.try_send_until(PUT(42), std::chrono::steady_clock::now() + 1ms));
+        REQUIRE(42 == GET(recv.try_receive_until(std::chrono::steady_clock::now() + 1ms).value()));
+    }
+
+    SECTION("segment boundaries") {
+        for (const auto size : { std::size_t(1), std::size_t(2), std::size_t(7), std::size_t(32) }) {
+            auto [send, recv] = segmented<TestType>(size);
+
+            for (auto burst = 0; burst < 3; ++burst) {
+                for (auto i = 0; i < 100; ++i) REQUIRE(send.send(PUT(i)));
+                for (auto i = 0; i < 100; ++i) REQUIRE(i == GET(recv.receive().value()));
+            }
+            REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+        }
+    }
+
+    SECTION("multiple senders (single thread)") {
+        auto [send, recv] = segmented<TestType>(2);
+
+        {
+            auto s1 = std::move(send);
+            auto s2 = s1;
+
+            REQUIRE(s1.send(PUT(1)));
+            REQUIRE(s2.send(PUT(2)));
+            REQUIRE(1 == GET(recv.receive().value()));
+            REQUIRE(s1.send(PUT(3)));
+        }
+
+        REQUIRE(2 == GET(recv.receive().value()));
+        REQUIRE(3 == GET(recv.receive().value()));
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+    }
+
+    SECTION("receive many") {
+        auto [send, recv] = segmented<TestType>(4);
+        auto out = std::vector<TestType>();
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.receive_many(std::back_inserter(out), 10).result);
+        for (auto i = 0; i < 10; ++i) REQUIRE(send.send(PUT(i)));
+
+        auto r = recv.receive_many(std::back_inserter(out), 3);
+        REQUIRE(r);
+        REQUIRE(3 == r.count);
+        r = recv.receive_many(std::back_inserter(out), 20);
+        REQUIRE(r);
+        REQUIRE(7 == r.count);
+        for (auto i = 0; i < 10; ++i) REQUIRE(i == GET(std::move(out[i])));
+
+        REQUIRE(send.send(PUT(10)));
+        {
+            auto s = std::move(send);
+        }
+        out.clear();
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(jjc::mpsc::status::CLOSED == r.result);
+        REQUIRE(1 == r.count);
+        REQUIRE(10 == GET(std::move(out[0])));
+    }
+
+    SECTION("send many") {
+        auto [send, recv] = segmented<TestType>(8);
+        auto items = std::vector<TestType>();
+        for (auto i = 0; i < 50; ++i) items.push_back(PUT(i));
+
+        // spans several segments, starting part way into the first
+        REQUIRE(send.send(PUT(-1)));
+        auto r = send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        REQUIRE(r);
+        REQUIRE(50 == r.count);
+        REQUIRE(-1 == GET(recv.receive().value()));
+        for (auto i = 0; i < 50; ++i) REQUIRE(i == GET(recv.receive().value()));
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+
+        {
+            auto rr = std::move(recv);
+        }
+        REQUIRE(jjc::mpsc::status::CLOSED == send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())).result);
+    }
+
+    SECTION("multiple senders") {
+        auto [send, recv] = segmented<TestType>(4);
+        static constexpr auto count = 100;
+        static constexpr auto senders = 5;
+        jjc::latch latch { senders + 1 };
+
+        std::array<std::thread, senders> threads {};
+        {
+            auto s = std::move(send);
+            for (auto& t : threads) t = std::thread([send = s, &latch]() mutable {
+                latch.arrive_and_wait();
+                for (auto i = 0; i < count; ++i) {
+                    send.send(PUT(i));
+                }
+            });
+        }
+
+        // each sender's items still arrive in order
+        auto next = std::array<int, senders>{};
+        auto total = 0;
+        latch.arrive_and_wait();
+        for (auto& v : recv) {
+            const auto i = GET(std::move(v));
+            auto* const sender = std::find(next.begin(), next.end(), i);
+            REQUIRE(sender != next.end());
+            ++*sender;
+            ++total;
+        }
+
+        REQUIRE(count * senders == total);
+        for (auto& t : threads) t.join();
+    }
+}
@@ -0,0 +1,115 @@
+#include <jjc/select.hpp>
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+TEST_CASE("select", "[select]") {
+    SECTION("ready receiver") {
+        auto [s1, r1] = jjc::mpsc::channel<int>();
+        auto [s2, r2] = jjc::mpsc::channel<std::string>(4);
+
+        REQUIRE(s2.send("a"));
+        REQUIRE(1 == jjc::mpsc::select(r1, r2));
+        REQUIRE(s1.send(1));
+        REQUIRE(0 == jjc::mpsc::select(r1, r2));
+
+        REQUIRE(1 == r1.try_receive().value());
+        REQUIRE(1 == jjc::mpsc::select(r1, r2));
+        REQUIRE("a" == r2.try_receive().value());
+    }
+
+    SECTION("every channel type wakes a waiting select") {
+        auto opts = jjc::mpsc::options{};
+        opts.segment_size = 8;
+        auto lanes = jjc::mpsc::options{};
+        lanes.per_sender_lanes = true;
+
+        auto [s1, r1] = jjc::mpsc::channel<int>();
+        auto [s2, r2] = jjc::mpsc::channel<int>(jjc::mpsc::unbounded, opts);
+        auto [s3, r3] = jjc::mpsc::channel<int>(jjc::mpsc::unbounded, lanes);
+        auto [s4, r4] = jjc::mpsc::channel<int>(2);
+        auto [s5, r5] = jjc::spsc::channel<int>(2);
+        auto [s6, r6] = jjc::mpmc::channel<int>();
+
+        auto send = [&](std::size_t i) {
+            switch (i) {
+            case 0: return s1.send(1).result;
+            case 1: return s2.send(1).result;
+            case 2: return s3.send(1).result;
+            case 3: return s4.send(1).result;
+            case 4: return s5.send(1).result;
+            default: return s6.send(1).result;
+            }
+        };
+
+        auto receive = [&](std::size_t i) {
+            switch (i) {
+            case 0: return r1.try_receive().result;
+            case 1: return r2.try_receive().result;
+            case 2: return r3.try_receive().result;
+            case 3: return r4.try_receive().result;
+            case 4: return r5.try_receive().result;
+            default: return r6.try_receive().result;
+            }
+        };
+
+        for (std::size_t i = 0; i < 6; ++i) {
+            auto t = std::thread([&send, i] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                send(i);
+            });
+            const auto ready = jjc::mpsc::select(r1, r2, r3, r4, r5, r6);
+            t.join();
+            REQUIRE(i == ready);
+            REQUIRE(jjc::mpsc::status::OK == receive(i));
+        }
+    }
+
+    SECTION("disconnected receivers are ready") {
+        auto [s1, r1] = jjc::mpsc::channel<int>();
+        auto [s2, r2] = jjc::mpsc::channel<int>(1);
+
+        auto t = std::thread([s = std::move(s2)] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        });
+        const auto ready = jjc::mpsc::select(r1, r2);
+        t.join();
+        REQUIRE(1 == ready);
+        REQUIRE(jjc::mpsc::status::CLOSED == r2.try_receive().result);
+    }
+
+    SECTION("timeout") {
+        auto [s1, r1] = jjc::mpsc::channel<int>();
+        auto [s2, r2] = jjc::spsc::channel<int>();
+
+        REQUIRE(!jjc::mpsc::try_select_for(std::chrono::milliseconds(1), r1, r2));
+        REQUIRE(!jjc::spsc::try_select_until(std::chrono::system_clock::now(), r1, r2));
+
+        REQUIRE(s2.send(1));
+        REQUIRE(1 == jjc::mpsc::try_select_for(std::chrono::milliseconds(1), r1, r2));
+    }
+
+    SECTION("rendezvous receivers are ready once a sender waits") {
+        auto [s1, r1] = jjc::mpsc::channel<int>();
+        auto [s2, r2] = jjc::mpsc::channel<int>(0);
+
+        REQUIRE(!jjc::mpsc::try_select_for(std::chrono::milliseconds(1), r1, r2));
+
+        auto t = std::thread([&s2 = s2] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            s2.send(1);
+        });
+        const auto ready = jjc::mpsc::select(r1, r2);
+        REQUIRE(1 == ready);
+        REQUIRE(1 == r2.try_receive().value());
+        t.join();
+
+        {
+            auto s = std::move(s2);
+        }
+        REQUIRE(1 == jjc::mpsc::select(r1, r2));
+        REQUIRE(jjc::mpsc::status::CLOSED == r2.try_receive().result);
+    }
+}
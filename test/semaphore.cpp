@@ -7,6 +7,28 @@
 #include <jjc/latch.hpp>
 #include <thread>
 
+TEST_CASE("binary_semaphore hand-off", "[primitive]") {
+    // Once a waiter has moved the semaphore to its waiting state, a release
+    // and a quick re-acquire put it back to the state the waiter had read.
+    // Parking on that stale value left the waiter asleep with nothing to
+    // wake it, so threads trading the semaphore back and forth would hang.
+    constexpr auto iterations = 20000;
+    jjc::binary_semaphore s{1};
+    alignas(64) int count = 0;
+
+    std::array<std::thread, 4> threads{};
+    for (auto& t : threads) t = std::thread([&] {
+        for (int i = 0; i < iterations; ++i) {
+            s.acquire();
+            ++count;
+            s.release();
+        }
+    });
+    for (auto& t : threads) t.join();
+
+    REQUIRE(static_cast<int>(threads.size()) * iterations == count);
+}
+
 TEST_CASE("counting_semaphore", "[primitive]") {
     using namespace std::chrono_literals;
 
@@ -20,6 +42,30 @@ TEST_CASE("counting_semaphore", "[primitive]") {
         REQUIRE(s.try_acquire_until(std::chrono::steady_clock::now() + 1ms));
     }
 
+    SECTION("contended hand-off") {
+        // Short holds are mostly caught by the spin, while the occasional
+        // long one sends the waiters on to park
+        constexpr auto permits = 2;
+        constexpr auto iterations = 2000;
+        jjc::counting_semaphore<> s{permits};
+        std::atomic_int held = 0;
+
+        std::array<std::thread, 4> threads{};
+        for (auto& t : threads) t = std::thread([&] {
+            for (int i = 0; i < iterations; ++i) {
+                s.acquire();
+                REQUIRE_T(held.fetch_add(1) < permits);
+                if (i % 256 == 0) std::this_thread::sleep_for(100us);
+                held.fetch_sub(1);
+                s.release();
+            }
+        });
+        for (auto& t : threads) t.join();
+
+        REQUIRE(s.try_acquire(permits));
+        REQUIRE(!s.try_acquire());
+    }
+
     SECTION("parallel blocking acquire") {
         constexpr auto count = 2;
         jjc::counting_semaphore<count> s{0};
@@ -84,4 +130,194 @@ TEST_CASE("counting_semaphore", "[primitive]") {
         for (auto& t : tasks) t.join();
         CHECK_NOFAIL(res == count);
     }
+
+    SECTION("multi-permit invariants") {
+        jjc::counting_semaphore<> s{5};
+        REQUIRE(s.try_acquire(3));
+        REQUIRE(!s.try_acquire(3));
+        REQUIRE(s.try_acquire(2));
+        REQUIRE(s.try_acquire(0));
+        s.release(5);
+        s.acquire(5);
+        REQUIRE(!s.try_acquire_for(2, 1ms));
+        s.release(2);
+        REQUIRE(s.try_acquire_until(2, std::chrono::system_clock::now() + 1ms));
+    }
+
+    SECTION("unequal demands") {
+        jjc::counting_semaphore<> s{0};
+        std::atomic_bool big_done = false;
+        std::atomic_bool small_done = false;
+
+        auto big = std::thread([&] {
+            s.acquire(3);
+            big_done = true;
+        });
+        std::this_thread::sleep_for(5ms);
+        auto small = std::thread([&] {
+            s.acquire();
+            small_done = true;
+        });
+        std::this_thread::sleep_for(5ms);
+
+        // not enough for the queued waiter, so the single one takes it
+        s.release(1);
+        small.join();
+        REQUIRE(small_done);
+        REQUIRE(!big_done);
+
+        s.release(3);
+        big.join();
+        REQUIRE(big_done);
+        REQUIRE(!s.try_acquire());
+    }
+
+    SECTION("queued waiters are served in order") {
+        jjc::counting_semaphore<> s{0};
+        std::atomic_int order = 0;
+        int first = 0;
+        int second = 0;
+
+        auto a = std::thread([&] {
+            s.acquire(4);
+            first = ++order;
+        });
+        std::this_thread::sleep_for(5ms);
+        auto b = std::thread([&] {
+            s.acquire(2);
+            second = ++order;
+        });
+        std::this_thread::sleep_for(5ms);
+
+        // enough for b, but a queued first
+        s.release(2);
+        std::this_thread::sleep_for(5ms);
+        REQUIRE(0 == order);
+        s.release(4);
+        a.join();
+        b.join();
+        REQUIRE(1 == first);
+        REQUIRE(2 == second);
+    }
+
+    SECTION("timed out multi-permit waiters leave the queue") {
+        jjc::counting_semaphore<> s{1};
+        REQUIRE(!s.try_acquire_for(3, 1ms));
+        s.release(2);
+        REQUIRE(s.try_acquire_for(3, 1ms));
+        REQUIRE(!s.try_acquire());
+    }
+
+    SECTION("a timed out waiter hands on the permits it held back") {
+        jjc::counting_semaphore<> s{0};
+        std::atomic_bool big_done = false;
+        std::atomic_bool small_done = false;
+
+        auto big = std::thread([&] {
+            REQUIRE_T(!s.try_acquire_for(5, 100ms));
+            big_done = true;
+        });
+        std::this_thread::sleep_for(5ms);
+        auto small = std::thread([&] {
+            s.acquire(2);
+            small_done = true;
+        });
+        std::this_thread::sleep_for(5ms);
+
+        // enough for the second waiter, but not the first one ahead of it
+        s.release(3);
+        std::this_thread::sleep_for(5ms);
+        REQUIRE(!small_done);
+
+        // no further release: the first waiter giving up lets the second go
+        big.join();
+        small.join();
+        REQUIRE(big_done);
+        REQUIRE(small_done);
+        REQUIRE(s.try_acquire());
+        REQUIRE(!s.try_acquire());
+    }
+
+    SECTION("parallel multi-permit acquire") {
+        constexpr auto count = 6;
+        constexpr auto iterations = 1000;
+        jjc::counting_semaphore<> s{count};
+        std::atomic_int held = 0;
+
+        std::array<std::thread, 6> tasks{};
+        for (std::size_t i = 0; i < tasks.size(); ++i) tasks[i] = std::thread([&, i] {
+            const auto n = static_cast<int>(i % 4) + 1;
+            for (int k = 0; k < iterations; ++k) {
+                s.acquire(n);
+                REQUIRE_T(held.fetch_add(n) + n <= count);
+                held.fetch_sub(n);
+                s.release(n);
+            }
+        });
+        for (auto& t : tasks) t.join();
+
+        REQUIRE(s.try_acquire(count));
+    }
+
+    SECTION("sub-millisecond timeouts") {
+        jjc::counting_semaphore<> s{0};
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(!s.try_acquire_for(300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 300us);
+        REQUIRE(!s.try_acquire_until(std::chrono::system_clock::now() + 300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 600us);
+    }
+}
+
+TEST_CASE("binary_semaphore", "[primitive]") {
+    using namespace std::chrono_literals;
+    jjc::binary_semaphore s{0};
+
+    SECTION("basic invariants") {
+        REQUIRE(!s.try_acquire());
+        s.release();
+        REQUIRE(s.try_acquire());
+        s.release();
+        REQUIRE(s.try_acquire_for(1ms));
+    }
+
+    SECTION("sub-millisecond timeouts") {
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(!s.try_acquire_for(300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 300us);
+        REQUIRE(!s.try_acquire_until(std::chrono::system_clock::now() + 300us));
+        REQUIRE(std::chrono::steady_clock::now() - start >= 600us);
+    }
+
+    SECTION("timed acquire is woken by release") {
+        auto t = std::thread([&] {
+            std::this_thread::sleep_for(5ms);
+            s.release();
+        });
+        REQUIRE(s.try_acquire_for(10s));
+        t.join();
+    }
+
+    SECTION("contended hand-off") {
+        // Short holds are mostly caught by the spin, while the occasional
+        // long one sends the waiters on to park
+        constexpr auto iterations = 2000;
+        std::atomic_bool held = false;
+        s.release();
+
+        std::array<std::thread, 4> threads{};
+        for (auto& t : threads) t = std::thread([&] {
+            for (int i = 0; i < iterations; ++i) {
+                s.acquire();
+                REQUIRE_T(!held.exchange(true));
+                if (i % 256 == 0) std::this_thread::sleep_for(100us);
+                held.store(false);
+                s.release();
+            }
+        });
+        for (auto& t : threads) t.join();
+
+        REQUIRE(s.try_acquire());
+        REQUIRE(!s.try_acquire());
+    }
 }
\ No newline at end of file
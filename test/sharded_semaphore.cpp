@@ -0,0 +1,88 @@
+#include <jjc/sharded_semaphore.hpp>
+#include <catch2/catch.hpp>
+
+#include <array>
+#include "assert_thread.hpp"
+#include <atomic>
+#include <jjc/latch.hpp>
+#include <thread>
+
+TEST_CASE("sharded_semaphore", "[primitive]") {
+    using namespace std::chrono_literals;
+
+    SECTION("basic invariants") {
+        jjc::sharded_semaphore s{2};
+        s.acquire();
+        REQUIRE(s.try_acquire());
+        REQUIRE(!s.try_acquire());
+        s.release(2);
+        REQUIRE(s.try_acquire_for(1ms));
+        REQUIRE(s.try_acquire_until(std::chrono::steady_clock::now() + 1ms));
+        REQUIRE(!s.try_acquire_until(std::chrono::system_clock::now() + 300us));
+    }
+
+    SECTION("permits released by one thread are stolen by others") {
+        constexpr auto count = 4;
+        jjc::sharded_semaphore s{0};
+        std::atomic_int res = 0;
+
+        std::array<std::thread, count> tasks{};
+        for (auto& t : tasks) t = std::thread([&] {
+            REQUIRE_T(s.try_acquire_for(10s));
+            res.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        // all of them land in this thread's stripe
+        for (int i = 0; i < count; ++i) {
+            std::this_thread::sleep_for(1ms);
+            s.release();
+        }
+        for (auto& t : tasks) t.join();
+
+        REQUIRE(count == res);
+        REQUIRE(!s.try_acquire());
+    }
+
+    SECTION("parallel non-blocking acquire") {
+        constexpr auto num_workers = 15;
+        constexpr auto count = 5;
+        jjc::sharded_semaphore s{count};
+        std::atomic<int> res = 0;
+        jjc::latch latch { num_workers + 1 };
+
+        const auto worker = [&] {
+            latch.arrive_and_wait();
+            if (s.try_acquire()) res.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        std::array<std::thread, num_workers> tasks{};
+        for (auto& t : tasks) t = std::thread(worker);
+
+        latch.arrive_and_wait();
+
+        for (auto& t : tasks) t.join();
+        REQUIRE(count == res);
+    }
+
+    SECTION("never more holders than permits") {
+        constexpr auto count = 3;
+        constexpr auto iterations = 2000;
+        jjc::sharded_semaphore s{count};
+        std::atomic_int holders = 0;
+
+        std::array<std::thread, 8> tasks{};
+        for (auto& t : tasks) t = std::thread([&] {
+            for (int i = 0; i < iterations; ++i) {
+                s.acquire();
+                const auto h = holders.fetch_add(1) + 1;
+                REQUIRE_T(h <= count);
+                holders.fetch_sub(1);
+                s.release();
+            }
+        });
+        for (auto& t : tasks) t.join();
+
+        for (int i = 0; i < count; ++i) REQUIRE(s.try_acquire());
+        REQUIRE(!s.try_acquire());
+    }
+}
@@ -0,0 +1,153 @@
+#include <jjc/shared_mutex.hpp>
+#include <catch2/catch.hpp>
+
+#include <array>
+#include "assert_thread.hpp"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+TEST_CASE("shared_mutex", "[primitive]") {
+    using namespace std::chrono_literals;
+
+    const auto preferences = { jjc::lock_preference::WRITERS, jjc::lock_preference::READERS };
+
+    SECTION("basic invariants") {
+        for (const auto preference : preferences) {
+            jjc::shared_mutex m { preference };
+
+            m.lock_shared();
+            REQUIRE(m.try_lock_shared());
+            REQUIRE(!m.try_lock());
+            REQUIRE(!m.try_lock_for(1ms));
+            m.unlock_shared();
+            m.unlock_shared();
+
+            REQUIRE(m.try_lock());
+            REQUIRE(!m.try_lock_shared());
+            REQUIRE(!m.try_lock_shared_for(1ms));
+            REQUIRE(!m.try_lock_until(std::chrono::steady_clock::now() + 1ms));
+            m.unlock();
+
+            REQUIRE(m.try_lock_shared_until(std::chrono::steady_clock::now() + 1ms));
+            m.unlock_shared();
+        }
+    }
+
+    SECTION("readers share across threads") {
+        for (const auto preference : preferences) {
+            jjc::shared_mutex m { preference };
+
+            const auto lk = std::shared_lock(m);
+            auto t = std::thread([&] {
+                REQUIRE_T(m.try_lock_shared());
+                m.unlock_shared();
+                REQUIRE_T(!m.try_lock());
+            });
+            t.join();
+        }
+    }
+
+    SECTION("writer waits for readers") {
+        for (const auto preference : preferences) {
+            jjc::shared_mutex m { preference };
+
+            std::atomic_bool reading = { true };
+            m.lock_shared();
+            auto t = std::thread([&] {
+                const auto lk = std::unique_lock(m);
+                REQUIRE_T(!reading.load());
+            });
+            std::this_thread::sleep_for(10ms);
+            reading.store(false);
+            m.unlock_shared();
+            t.join();
+        }
+    }
+
+    SECTION("readers wait for the writer") {
+        for (const auto preference : preferences) {
+            jjc::shared_mutex m { preference };
+
+            std::atomic_bool writing = { true };
+            m.lock();
+            std::array<std::thread, 4> readers {};
+            for (auto& t : readers) t = std::thread([&] {
+                const auto lk = std::shared_lock(m);
+                REQUIRE_T(!writing.load());
+            });
+            std::this_thread::sleep_for(10ms);
+            writing.store(false);
+            m.unlock();
+            for (auto& t : readers) t.join();
+        }
+    }
+
+    SECTION("readers and writers exclude each other") {
+        for (const auto preference : preferences) {
+            jjc::shared_mutex m { preference };
+
+            constexpr auto iterations = 2000;
+            // written only under the exclusive lock, and always even outside it
+            alignas(64) int value = 0;
+            std::atomic_int readers = { 0 };
+
+            std::array<std::thread, 6> threads {};
+            for (std::size_t i = 0; i < threads.size(); ++i) threads[i] = std::thread([&, i] {
+                for (int n = 0; n < iterations; ++n) {
+                    if (i % 3 == 0) {
+                        const auto lk = std::unique_lock(m);
+                        REQUIRE_T(0 == readers.load());
+                        ++value;
+                        ++value;
+                    }
+                    else {
+                        const auto lk = std::shared_lock(m);
+                        readers.fetch_add(1);
+                        REQUIRE_T(value % 2 == 0);
+                        readers.fetch_sub(1);
+                    }
+                }
+            });
+            for (auto& t : threads) t.join();
+
+            REQUIRE(2 * 2 * iterations == value);
+        }
+    }
+
+    SECTION("a waiting writer holds back new readers") {
+        jjc::shared_mutex m { jjc::lock_preference::WRITERS };
+        m.lock_shared();
+        auto t = std::thread([&] {
+            m.lock();
+            m.unlock();
+        });
+        std::this_thread::sleep_for(10ms);
+
+        auto reader = std::thread([&] {
+            REQUIRE_T(!m.try_lock_shared());
+        });
+        reader.join();
+        m.unlock_shared();
+        t.join();
+    }
+
+    SECTION("readers get in past a waiting writer") {
+        jjc::shared_mutex m { jjc::lock_preference::READERS };
+        m.lock_shared();
+        auto t = std::thread([&] {
+            m.lock();
+            m.unlock();
+        });
+        std::this_thread::sleep_for(10ms);
+
+        auto reader = std::thread([&] {
+            REQUIRE_T(m.try_lock_shared());
+            m.unlock_shared();
+        });
+        reader.join();
+        m.unlock_shared();
+        t.join();
+    }
+}
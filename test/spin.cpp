@@ -0,0 +1,39 @@
+#include <jjc/detail/spin.hpp>
+#include <catch2/catch.hpp>
+
+TEST_CASE("adaptive_spin", "[detail]") {
+    jjc::detail::concurrency::adaptive_spin s;
+    REQUIRE(s.estimate() == 0);
+
+    // run() rather than spin() so that this also holds on a single core.
+    // The returned predicate is ready on the fourth backoff round, after
+    // 1 + 2 + 4 + 8 relaxes.
+    const auto fourth_round = [] {
+        return [n = 0]() mutable { return ++n == 4; };
+    };
+
+    SECTION("successful spins grow the estimate") {
+        auto last = s.estimate();
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(s.run(fourth_round()));
+            REQUIRE(s.estimate() > last);
+            last = s.estimate();
+        }
+
+        for (int i = 0; i < 100; ++i) REQUIRE(s.run(fourth_round()));
+        REQUIRE(s.estimate() >= last);
+        REQUIRE(s.estimate() <= 15);
+    }
+
+    SECTION("failed spins decay the estimate to zero") {
+        for (int i = 0; i < 100; ++i) s.run(fourth_round());
+        auto last = s.estimate();
+        REQUIRE(last > 0);
+
+        while (last > 0) {
+            REQUIRE(!s.run([] { return false; }));
+            REQUIRE(s.estimate() < last);
+            last = s.estimate();
+        }
+    }
+}
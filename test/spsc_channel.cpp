@@ -0,0 +1,138 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+#include "channel_test_help.hpp"
+#include <future>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+static_assert(!std::is_copy_constructible_v<jjc::spsc::sender<int>>);
+static_assert(std::is_move_constructible_v<jjc::spsc::sender<int>>);
+
+TEST_CASE("spsc channel type agnostic", "[spsc]") {
+    SECTION("sender disconnect") {
+        for (const auto capacity : { jjc::spsc::unbounded, std::ptrdiff_t(1) }) {
+            auto [send, recv] = jjc::spsc::channel<int>(capacity);
+
+            {
+                auto s = std::move(send);
+            }
+
+            REQUIRE(jjc::spsc::status::CLOSED == recv.receive().result);
+            REQUIRE(jjc::spsc::status::CLOSED == recv.try_receive().result);
+        }
+    }
+
+    SECTION("receiver closes") {
+        for (const auto capacity : { jjc::spsc::unbounded, std::ptrdiff_t(1) }) {
+            auto [send, recv] = jjc::spsc::channel<int>(capacity);
+
+            {
+                auto r = std::move(recv);
+            }
+
+            REQUIRE(jjc::spsc::status::CLOSED == send.send(42));
+        }
+    }
+
+    SECTION("invalid capacity") {
+        REQUIRE_THROWS_AS(jjc::spsc::channel<int>(-2), jjc::spsc::invalid_capacity);
+    }
+}
+
+TEMPLATE_TEST_CASE("spsc channel", "[spsc]", int, std::unique_ptr<int>) {
+    SECTION("basic invariants") {
+        using namespace std::chrono_literals;
+        for (const auto capacity : { jjc::spsc::unbounded, std::ptrdiff_t(1), std::ptrdiff_t(4) }) {
+            auto [send, recv] = jjc::spsc::channel<TestType>(capacity);
+
+            REQUIRE((capacity == jjc::spsc::unbounded ? jjc::spsc::blocking::NEVER : jjc::spsc::blocking::SOMETIMES) == send.blocks());
+            REQUIRE(jjc::spsc::blocking::SOMETIMES == recv.blocks());
+
+            REQUIRE(jjc::spsc::status::WOULD_BLOCK == recv.try_receive().result);
+            REQUIRE(jjc::spsc::status::TIMEOUT == recv.try_receive_for(1ms).result);
+            REQUIRE(send.send(PUT(42)));
+            REQUIRE(42 == GET(recv.receive().value()));
+            REQUIRE(send.try_send(PUT(42)));
+            REQUIRE(42 == GET(recv.try_receive().value()));
+            REQUIRE(send.try_send_for(PUT(42), 1ms));
+            REQUIRE(42 == GET(recv.try_receive_for(1ms).value()));
+            REQUIRE(send.try_send_until(PUT(42), std::chrono::steady_clock::now() + 1ms));
+            REQUIRE(42 == GET(recv.try_receive_until(std::chrono::steady_clock::now() + 1ms).value()));
+        }
+    }
+
+    SECTION("bounded wraps around") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = jjc::spsc::channel<TestType>(3);
+
+        for (auto lap = 0; lap < 5; ++lap) {
+            for (auto i = 0; i < 3; ++i) REQUIRE(send.try_send(PUT(i)));
+            REQUIRE(jjc::spsc::status::WOULD_BLOCK == send.try_send(PUT(3)));
+            REQUIRE(jjc::spsc::status::TIMEOUT == send.try_send_for(PUT(3), 1ms));
+            for (auto i = 0; i < 3; ++i) REQUIRE(i == GET(recv.receive().value()));
+        }
+    }
+
+    SECTION("unbounded segments") {
+        auto opts = jjc::spsc::options{};
+        opts.segment_size = 2;
+        auto [send, recv] = jjc::spsc::channel<TestType>(jjc::spsc::unbounded, opts);
+
+        for (auto burst = 0; burst < 3; ++burst) {
+            for (auto i = 0; i < 9; ++i) REQUIRE(send.send(PUT(i)));
+            for (auto i = 0; i < 9; ++i) REQUIRE(i == GET(recv.receive().value()));
+        }
+        REQUIRE(jjc::spsc::status::WOULD_BLOCK == recv.try_receive().result);
+    }
+
+    SECTION("send and receive many") {
+        auto [send, recv] = jjc::spsc::channel<TestType>(4);
+        auto items = std::vector<TestType>();
+        for (auto i = 0; i < 6; ++i) items.push_back(PUT(i));
+        auto first = std::make_move_iterator(items.begin());
+        const auto last = std::make_move_iterator(items.end());
+
+        auto r = send.try_send_many(first, last);
+        REQUIRE(jjc::spsc::status::WOULD_BLOCK == r.result);
+        REQUIRE(4 == r.count);
+        std::advance(first, r.count);
+
+        auto out = std::vector<TestType>();
+        auto got = recv.receive_many(std::back_inserter(out), 3);
+        REQUIRE(3 == got.count);
+        REQUIRE(send.send_many(first, last));
+        got = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(3 == got.count);
+        for (auto i = 0; i < 6; ++i) REQUIRE(i == GET(std::move(out[i])));
+
+        {
+            auto s = std::move(send);
+        }
+        REQUIRE(jjc::spsc::status::CLOSED == recv.receive_many(std::back_inserter(out), 10).result);
+    }
+
+    SECTION("one sender") {
+        static constexpr auto count = 1000;
+        for (const auto capacity : { jjc::spsc::unbounded, std::ptrdiff_t(1), std::ptrdiff_t(16) }) {
+            auto [send, recv] = jjc::spsc::channel<TestType>(capacity);
+
+            auto s = std::async(std::launch::async, [send = std::move(send)]() mutable {
+                auto s = std::move(send);
+                for (auto i = 0; i < count; ++i) {
+                    REQUIRE_T(s.send(PUT(i)));
+                }
+            });
+
+            auto i = 0;
+            for (auto& v : recv) {
+                REQUIRE(i++ == GET(std::move(v)));
+            }
+            REQUIRE(count == i);
+            s.get();
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#include <jjc/channel.hpp>
+#include <catch2/catch.hpp>
+
+#include "assert_thread.hpp"
+#include "channel_test_help.hpp"
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using jjc::mpsc::kind;
+
+template<kind K, typename T>
+auto make_channel() {
+    if constexpr (K == kind::bounded) return jjc::mpsc::channel<T, K>(4);
+    else return jjc::mpsc::channel<T, K>();
+}
+
+template<kind K>
+using kind_constant = std::integral_constant<kind, K>;
+
+TEMPLATE_TEST_CASE("static channel", "[mpsc]",
+    kind_constant<kind::unbounded>, kind_constant<kind::segmented>,
+    kind_constant<kind::bounded>, kind_constant<kind::rendezvous>
+) {
+    auto [send, recv] = make_channel<TestType::value, std::unique_ptr<int>>();
+
+    SECTION("send and receive") {
+        auto t = std::async(std::launch::async, [send = std::move(send)]() mutable {
+            for (int i = 0; i < 100; ++i) REQUIRE_T(send.send(std::make_unique<int>(i)));
+        });
+
+        for (int i = 0; i < 100; ++i) REQUIRE(i == *recv.receive().value());
+        t.get();
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+    }
+
+    SECTION("copies keep the channel open") {
+        auto copy = send;
+        {
+            auto s = std::move(send);
+        }
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+
+        {
+            auto s = std::move(copy);
+        }
+        REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
+    }
+
+    SECTION("receiver closes") {
+        {
+            auto r = std::move(recv);
+        }
+
+        auto r = send.send(std::make_unique<int>(42));
+        REQUIRE(jjc::mpsc::status::CLOSED == r);
+        REQUIRE(42 == *r.item.value());
+    }
+
+    SECTION("moved-to handles drop what they held") {
+        auto [send2, recv2] = make_channel<TestType::value, std::unique_ptr<int>>();
+        send2 = std::move(send);
+        recv2 = std::move(recv);
+        {
+            auto s = std::move(send2);
+        }
+        REQUIRE(jjc::mpsc::status::CLOSED == recv2.receive().result);
+    }
+}
+
+TEST_CASE("static channel many senders", "[mpsc]") {
+    auto [send, recv] = jjc::mpsc::channel<int, kind::bounded>(8);
+    constexpr int senders = 4;
+    constexpr int per_sender = 1000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < senders; ++i) {
+        threads.emplace_back([send = send]() mutable {
+            for (int j = 0; j < per_sender; ++j) REQUIRE_T(send.send(j));
+        });
+    }
+    {
+        auto s = std::move(send);
+    }
+
+    long long sum = 0;
+    int count = 0;
+    for (auto v : recv) {
+        sum += v;
+        ++count;
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(senders * per_sender == count);
+    REQUIRE(senders * (per_sender * (per_sender - 1LL) / 2) == sum);
+}
+
+TEST_CASE("static channel options", "[mpsc]") {
+    REQUIRE_THROWS_AS((jjc::mpsc::channel<int, kind::bounded>(0)), jjc::mpsc::invalid_capacity);
+
+    auto opts = jjc::mpsc::options{};
+    opts.segment_size = 2;
+    auto [send, recv] = jjc::mpsc::channel<int, kind::segmented>(opts);
+    REQUIRE(jjc::mpsc::blocking::NEVER == send.blocks());
+    for (int i = 0; i < 5; ++i) REQUIRE(send.send(i));
+
+    std::vector<int> got;
+    REQUIRE(5 == recv.receive_many(std::back_inserter(got), 10).count);
+    REQUIRE(std::vector<int>{ 0, 1, 2, 3, 4 } == got);
+}
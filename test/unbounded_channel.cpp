@@ -4,9 +4,11 @@
 #include <array>
 #include "channel_test_help.hpp"
 #include <future>
+#include <iterator>
 #include <jjc/latch.hpp>
 #include <memory>
 #include <thread>
+#include <vector>
 
 TEST_CASE("unbounded channel type agnostic", "[mpsc]") {
     SECTION("one sender disconnect") {
@@ -69,6 +71,94 @@ TEMPLATE_TEST_CASE("unbounded channel", "[mpsc]", int, std::unique_ptr<int>) {
         REQUIRE(jjc::mpsc::status::CLOSED == recv.receive().result);
     }
 
+    SECTION("receive many") {
+        auto [send, recv] = jjc::mpsc::channel<TestType>();
+        auto out = std::vector<TestType>();
+
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.receive_many(std::back_inserter(out), 10).result);
+        for (auto i = 0; i < 5; ++i) REQUIRE(send.send(PUT(i)));
+
+        auto r = recv.receive_many(std::back_inserter(out), 3);
+        REQUIRE(r);
+        REQUIRE(3 == r.count);
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(r);
+        REQUIRE(2 == r.count);
+        REQUIRE(5 == out.size());
+        for (auto i = 0; i < 5; ++i) REQUIRE(i == GET(std::move(out[i])));
+
+        REQUIRE(send.send(PUT(5)));
+        {
+            auto s = std::move(send);
+        }
+        out.clear();
+        r = recv.receive_many(std::back_inserter(out), 10);
+        REQUIRE(jjc::mpsc::status::CLOSED == r.result);
+        REQUIRE(1 == r.count);
+        REQUIRE(5 == GET(std::move(out[0])));
+    }
+
+    SECTION("receive batch") {
+        using namespace std::chrono_literals;
+        auto [send, recv] = jjc::mpsc::channel<TestType>();
+
+        for (auto i = 0; i < 3; ++i) REQUIRE(send.send(PUT(i)));
+        auto batch = recv.receive_batch(2, 1ms);
+        REQUIRE(jjc::mpsc::status::OK == batch.result);
+        REQUIRE(2 == batch.size());
+        REQUIRE(0 == GET(std::move(batch[0])));
+        REQUIRE(1 == GET(std::move(batch[1])));
+
+        // lingers for more, but returns what it has once the deadline passes
+        batch = recv.receive_batch(10, 1ms);
+        REQUIRE(jjc::mpsc::status::OK == batch.result);
+        REQUIRE(1 == batch.size());
+        REQUIRE(2 == GET(std::move(batch[0])));
+
+        REQUIRE(send.send(PUT(3)));
+        {
+            auto s = std::move(send);
+        }
+        batch = recv.receive_batch(10, 1ms);
+        REQUIRE(jjc::mpsc::status::CLOSED == batch.result);
+        REQUIRE(1 == batch.size());
+        REQUIRE(3 == GET(std::move(batch[0])));
+    }
+
+    SECTION("send many") {
+        auto [send, recv] = jjc::mpsc::channel<TestType>();
+        auto items = std::vector<TestType>();
+        for (auto i = 0; i < 5; ++i) items.push_back(PUT(i));
+
+        auto r = send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        REQUIRE(r);
+        REQUIRE(5 == r.count);
+        REQUIRE(send.try_send_many(std::make_move_iterator(items.end()), std::make_move_iterator(items.end())));
+        for (auto i = 0; i < 5; ++i) REQUIRE(i == GET(recv.receive().value()));
+        REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+
+        {
+            auto rr = std::move(recv);
+        }
+        items.push_back(PUT(5));
+        REQUIRE(jjc::mpsc::status::CLOSED == send.send_many(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())).result);
+    }
+
+    SECTION("node pool") {
+        for (const auto high_water : { std::size_t(0), std::size_t(4), std::size_t(1024) }) {
+            auto opts = jjc::mpsc::options{};
+            opts.pool_high_water = high_water;
+            auto [send, recv] = jjc::mpsc::channel<TestType>(jjc::mpsc::unbounded, opts);
+
+            // bursts larger than the pool, so nodes are both reused and freed
+            for (auto burst = 0; burst < 3; ++burst) {
+                for (auto i = 0; i < 100; ++i) REQUIRE(send.send(PUT(i)));
+                for (auto i = 0; i < 100; ++i) REQUIRE(i == GET(recv.receive().value()));
+            }
+            REQUIRE(jjc::mpsc::status::WOULD_BLOCK == recv.try_receive().result);
+        }
+    }
+
     SECTION("one sender") {
         auto [send, recv] = jjc::mpsc::channel<TestType>();
         static constexpr auto count = 5;